@@ -0,0 +1,222 @@
+/* bench_hotpaths.c
+ * Microbenchmarks: the per-command parsing and bookkeeping paths
+ *   tokenize          - split a typical command line (quotes, operators)
+ *   expand_variables  - expand a tokenized line with set / unset $VARs
+ *   add_to_history    - ring insert plus the history file append
+ *   glob              - expand "/usr/bin/g*" with a warm directory cache
+ *   complete_command  - one Tab on a first word: PATH trie lookup for
+ *                       common prefixes (the one-time trie build is
+ *                       reported separately as complete_build)
+ *   trace_record      - one record appended to the trace ring (trace on)
+ *   shell_envp        - the envp handed to every exec, with 1000 exported
+ *                       variables: cached, and rebuilt after one changed
+ * Each case runs REPEATS times; the best ns/op is reported, one JSON
+ * object per line, so runs from different builds can be diffed.
+ * Built and run by: make bench
+ */
+
+#include "shell.h"
+#include <time.h>
+
+#define REPEATS 5
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static const char* const lines[] = {
+    "ls -l /tmp",
+    "grep -n \"some pattern\" file.txt | sort | uniq -c > counts.txt",
+    "echo $HOME $USER literal 'single quoted' $UNSET_VARIABLE",
+    "cc -Wall -O2 -Iinclude -c src/main.c -o obj/main.o",
+};
+#define NLINES (sizeof(lines) / sizeof(lines[0]))
+
+static void report(const char* name, long ops, double best_ns) {
+    printf("{\"suite\":\"micro\",\"name\":\"%s\",\"ops\":%ld,\"ns_per_op\":%.1f}\n",
+           name, ops, best_ns / ops);
+}
+
+static void bench_tokenize(long ops) {
+    char buf[MAX_LEN];
+    double best = 0;
+    volatile size_t sink = 0;
+
+    for (int r = 0; r < REPEATS; r++) {
+        double start = now_ns();
+        for (long i = 0; i < ops; i++) {
+            // tokenize() works on a copy, so the line can be reused
+            strcpy(buf, lines[i % NLINES]);
+            char** args = tokenize(buf);
+            sink += (size_t)args[0];
+            arena_reset(&cmd_arena);
+        }
+        double elapsed = now_ns() - start;
+        if (r == 0 || elapsed < best) best = elapsed;
+    }
+    report("tokenize", ops, best);
+}
+
+static void bench_expand(long ops) {
+    char buf[MAX_LEN];
+    double best = 0;
+    volatile size_t sink = 0;
+
+    set_variable("HOME", "/home/bench");
+    set_variable("USER", "bench");
+
+    for (int r = 0; r < REPEATS; r++) {
+        double elapsed = 0;
+        for (long i = 0; i < ops; i++) {
+            strcpy(buf, lines[i % NLINES]);
+            char** args = tokenize(buf);
+
+            // Only the expansion pass is timed
+            double start = now_ns();
+            char** expanded = expand_variables(args);
+            elapsed += now_ns() - start;
+
+            sink += (size_t)expanded[0];
+            arena_reset(&cmd_arena);
+        }
+        if (r == 0 || elapsed < best) best = elapsed;
+    }
+    report("expand_variables", ops, best);
+    free_all_variables();
+}
+
+static void bench_history(long ops) {
+    char path[] = "/tmp/bench_history.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return;
+    }
+    close(fd);
+    setenv("MYSHELL_HISTFILE", path, 1);
+    history_init();
+
+    double best = 0;
+    for (int r = 0; r < REPEATS; r++) {
+        double start = now_ns();
+        for (long i = 0; i < ops; i++) {
+            add_to_history(lines[i % NLINES]);
+        }
+        double elapsed = now_ns() - start;
+        if (r == 0 || elapsed < best) best = elapsed;
+    }
+    report("add_to_history", ops, best);
+
+    history_close();
+    unlink(path);
+}
+
+static void bench_glob(long ops) {
+    char buf[MAX_LEN];
+    double best = 0;
+    volatile size_t sink = 0;
+
+    for (int r = 0; r < REPEATS; r++) {
+        double start = now_ns();
+        for (long i = 0; i < ops; i++) {
+            strcpy(buf, "ls /usr/bin/g*");
+            char** expanded = expand_variables(tokenize(buf));
+            sink += (size_t)expanded[1];
+            arena_reset(&cmd_arena);
+        }
+        double elapsed = now_ns() - start;
+        if (r == 0 || elapsed < best) best = elapsed;
+    }
+    report("glob", ops, best);
+    glob_cache_free();
+}
+
+// Drains one completion the way readline does, freeing every match
+static long complete_once(const char* prefix) {
+    long n = 0;
+    for (char* m = command_generator(prefix, 0); m != NULL; m = command_generator(prefix, 1)) {
+        free(m);
+        n++;
+    }
+    return n;
+}
+
+static void bench_complete(long ops) {
+    static const char* const prefixes[] = { "g", "ls", "py", "s", "x" };
+    int nprefixes = sizeof(prefixes) / sizeof(prefixes[0]);
+
+    double start = now_ns();
+    long commands = complete_once("");
+    report("complete_build", 1, now_ns() - start);
+
+    double best = 0;
+    for (int r = 0; r < REPEATS; r++) {
+        start = now_ns();
+        for (long i = 0; i < ops; i++) complete_once(prefixes[i % nprefixes]);
+        double elapsed = now_ns() - start;
+        if (r == 0 || elapsed < best) best = elapsed;
+    }
+    printf("{\"suite\":\"micro\",\"name\":\"complete_command\",\"commands_on_path\":%ld,"
+           "\"ops\":%ld,\"ns_per_op\":%.1f}\n", commands, ops, best / ops);
+}
+
+static void bench_trace(long ops) {
+    char* on[] = { "trace", "on", NULL };
+    builtin_trace(on);
+
+    double best = 0;
+    for (int r = 0; r < REPEATS; r++) {
+        double start = now_ns();
+        for (long i = 0; i < ops; i++) trace_record(TRACE_SPAWN, TRACE_BEGIN, (pid_t)i);
+        double elapsed = now_ns() - start;
+        if (r == 0 || elapsed < best) best = elapsed;
+    }
+    report("trace_record", ops, best);
+    trace_free();
+}
+
+static void bench_envp(long ops) {
+    char name[32];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(name, sizeof(name), "BENCH_VAR_%d", i);
+        export_variable(name, "some exported value");
+    }
+    volatile size_t sink = 0;
+
+    double best = 0;
+    for (int r = 0; r < REPEATS; r++) {
+        double start = now_ns();
+        for (long i = 0; i < ops; i++) sink += (size_t)shell_envp();
+        double elapsed = now_ns() - start;
+        if (r == 0 || elapsed < best) best = elapsed;
+    }
+    report("shell_envp_cached", ops, best);
+
+    best = 0;
+    long rebuilds = ops / 100;
+    for (int r = 0; r < REPEATS; r++) {
+        double start = now_ns();
+        for (long i = 0; i < rebuilds; i++) {
+            set_variable("BENCH_VAR_0", (i & 1) ? "odd" : "even");
+            sink += (size_t)shell_envp();
+        }
+        double elapsed = now_ns() - start;
+        if (r == 0 || elapsed < best) best = elapsed;
+    }
+    report("shell_envp_rebuild", rebuilds, best);
+    free_all_variables();
+}
+
+int main() {
+    bench_tokenize(200000);
+    bench_expand(200000);
+    bench_history(20000);
+    bench_glob(20000);
+    bench_complete(2000);
+    bench_trace(1000000);
+    bench_envp(1000000);
+    arena_free(&cmd_arena);
+    return 0;
+}
@@ -0,0 +1,53 @@
+/* bench_vars.c
+ * Microbenchmark: find_variable() cost as the variable store grows
+ * Fills the store with 10 .. 100000 variables and times random lookups
+ * of existing names; with the hash table ns_per_op stays flat. One JSON
+ * object per store size.
+ * Built and run by: make bench
+ */
+
+#include "shell.h"
+#include <time.h>
+
+#define LOOKUPS 1000000
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main() {
+    static const int sizes[] = { 10, 100, 1000, 10000, 100000 };
+    char name[32];
+    unsigned int seed = 12345;
+    volatile size_t sink = 0;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        for (int i = 0; i < n; i++) {
+            snprintf(name, sizeof(name), "CONFIG_VAR_%d", i);
+            set_variable(name, "value");
+        }
+
+        // Pre-build the probe names so only find_variable() is timed
+        char (*names)[32] = malloc(sizeof(*names) * 4096);
+        for (int i = 0; i < 4096; i++) {
+            seed = seed * 1103515245u + 12345u;
+            snprintf(names[i], 32, "CONFIG_VAR_%u", (seed >> 8) % n);
+        }
+
+        double start = now_ns();
+        for (int i = 0; i < LOOKUPS; i++) {
+            var_node_t* var = find_variable(names[i & 4095]);
+            sink += (size_t)var;
+        }
+        double elapsed = now_ns() - start;
+
+        printf("{\"suite\":\"micro\",\"name\":\"find_variable\",\"variables\":%d,\"ns_per_op\":%.1f}\n",
+               n, elapsed / LOOKUPS);
+        free(names);
+        free_all_variables();
+    }
+    return sink == 0;
+}
@@ -0,0 +1,44 @@
+#!/bin/sh
+# builtin_latency.sh - per-command latency of in-process built-ins vs exec
+# Runs the same N-line batch script twice through the shell: once with the
+# built-in utilities, once with the external binaries (absolute paths skip
+# the built-in table), and prints microseconds per command as JSON lines.
+# Usage: bench/builtin_latency.sh [path/to/myshell] [N]
+# Built and run by: make bench
+
+SHELL_BIN=${1:-bin/myshell}
+N=${2:-2000}
+TMP=${TMPDIR:-/tmp}/builtin_latency.$$
+
+# `command -v` would report the sh built-ins, so search PATH directly
+find_bin() {
+    for dir in $(echo "$PATH" | tr ':' ' '); do
+        if [ -x "$dir/$1" ]; then echo "$dir/$1"; return; fi
+    done
+}
+TRUE_BIN=$(find_bin true)
+ECHO_BIN=$(find_bin echo)
+trap 'rm -f "$TMP".*' EXIT
+
+i=0
+: > "$TMP.builtin"
+: > "$TMP.external"
+while [ $i -lt "$N" ]; do
+    echo "true" >> "$TMP.builtin"
+    echo "echo line $i > /dev/null" >> "$TMP.builtin"
+    echo "$TRUE_BIN" >> "$TMP.external"
+    echo "$ECHO_BIN line $i > /dev/null" >> "$TMP.external"
+    i=$((i + 1))
+done
+
+run() {
+    start=$(date +%s%N)
+    "$SHELL_BIN" "$1" > /dev/null
+    end=$(date +%s%N)
+    echo $(( (end - start) / 1000 / (N * 2) ))
+}
+
+for mode in builtin external; do
+    printf '{"suite":"latency","name":"%s","commands":%d,"us_per_command":%s}\n' \
+        "$mode" $((N * 2)) "$(run "$TMP.$mode")"
+done
@@ -0,0 +1,105 @@
+#!/bin/sh
+# macro.sh - whole-shell throughput and per-command latency
+# Generates batch scripts with thousands of commands and runs each one
+# through the shell twice: plainly, for commands/sec, and with "stats on",
+# whose per-command wall times give the p50 / p99 latency.
+# commands_per_sec counts every command the workload runs (assignments, if
+# conditions, each side of && / || that runs); "recorded" is how many of
+# them the stats table kept, which the percentiles are taken over.
+#   builtins  - built-ins, variable expansion and assignments
+#   external  - fork/exec of a real binary
+#   pipeline  - three-stage pipelines with redirection
+#   ifblock   - multi-line if/then/else/fi blocks
+#   andor     - guards with && / ||; the skipped command is an external
+#               one, so any work spent on it shows up
+# Output: one JSON object per workload.
+# Usage: bench/macro.sh [path/to/myshell] [scale]
+# Built and run by: make bench
+
+SHELL_BIN=${1:-bin/myshell}
+SCALE=${2:-1}
+TMP=${TMPDIR:-/tmp}/macro_bench.$$
+
+# `command -v` would report the sh built-ins, so search PATH directly
+find_bin() {
+    for dir in $(echo "$PATH" | tr ':' ' '); do
+        if [ -x "$dir/$1" ]; then echo "$dir/$1"; return; fi
+    done
+}
+TRUE_BIN=$(find_bin true)
+trap 'rm -f "$TMP".*' EXIT
+
+gen_builtins() {
+    i=0
+    while [ $i -lt $((2000 * SCALE)) ]; do
+        echo "N=$i"
+        echo "echo value \$N > /dev/null"
+        echo "true"
+        i=$((i + 1))
+    done
+    echo $((i * 3)) > "$TMP.count"
+}
+
+gen_external() {
+    i=0
+    while [ $i -lt $((1000 * SCALE)) ]; do
+        echo "$TRUE_BIN arg $i"
+        i=$((i + 1))
+    done
+    echo $i > "$TMP.count"
+}
+
+gen_pipeline() {
+    i=0
+    while [ $i -lt $((500 * SCALE)) ]; do
+        echo "echo line $i | cat | wc -c > /dev/null"
+        i=$((i + 1))
+    done
+    echo $i > "$TMP.count"
+}
+
+gen_ifblock() {
+    i=0
+    while [ $i -lt $((1000 * SCALE)) ]; do
+        echo "if true"
+        echo "then"
+        echo "  echo yes $i > /dev/null"
+        echo "else"
+        echo "  echo no > /dev/null"
+        echo "fi"
+        i=$((i + 1))
+    done
+    echo $((i * 2)) > "$TMP.count"     # condition + the branch taken
+}
+
+gen_andor() {
+    i=0
+    while [ $i -lt $((2000 * SCALE)) ]; do
+        echo "false && $TRUE_BIN skipped $i || echo ran $i > /dev/null"
+        i=$((i + 1))
+    done
+    echo $((i * 2)) > "$TMP.count"     # false + echo; the skipped one never runs
+}
+
+for workload in builtins external pipeline ifblock andor; do
+    "gen_$workload" > "$TMP.script"
+    { echo "stats on"; cat "$TMP.script"; echo "stats dump > $TMP.stats"; } > "$TMP.timed"
+
+    start=$(date +%s%N)
+    "$SHELL_BIN" "$TMP.script" > /dev/null
+    end=$(date +%s%N)
+    "$SHELL_BIN" "$TMP.timed" > /dev/null
+    commands=$(cat "$TMP.count")
+
+    # Column 1 of the stats table is wall seconds per command
+    grep -v '^#' "$TMP.stats" | cut -f1 | sort -n | awk \
+        -v name="$workload" -v ns=$((end - start)) -v commands=$commands '
+        { wall[NR] = $1 }
+        END {
+            p50 = wall[int((NR - 1) * 0.50) + 1] * 1e6
+            p99 = wall[int((NR - 1) * 0.99) + 1] * 1e6
+            printf "{\"suite\":\"macro\",\"name\":\"%s\",\"commands\":%d,\"recorded\":%d,", name, commands, NR
+            printf "\"seconds\":%.4f,\"commands_per_sec\":%.0f,", ns / 1e9, commands / (ns / 1e9)
+            printf "\"p50_us\":%.1f,\"p99_us\":%.1f}\n", p50, p99
+        }'
+done
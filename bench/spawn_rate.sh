@@ -0,0 +1,52 @@
+#!/bin/sh
+# spawn_rate.sh - external command launch rate per spawn backend
+# Runs the same batch of short-lived commands through each backend (fork,
+# posix, zygote), once from a small shell and once after the shell has
+# grown a large heap (a big variable), where fork() has to copy the page
+# tables of every mapped page and the zygote's tiny address space pays off.
+# Output: one JSON object per backend and heap size.
+# Usage: bench/spawn_rate.sh [path/to/myshell] [scale]
+# Built and run by: make bench
+
+SHELL_BIN=${1:-bin/myshell}
+SCALE=${2:-1}
+TMP=${TMPDIR:-/tmp}/spawn_bench.$$
+COUNT=$((1000 * SCALE))
+
+# `command -v` would report the sh built-ins, so search PATH directly
+find_bin() {
+    for dir in $(echo "$PATH" | tr ':' ' '); do
+        if [ -x "$dir/$1" ]; then echo "$dir/$1"; return; fi
+    done
+}
+TRUE_BIN=$(find_bin true)
+SEQ_BIN=$(find_bin seq)
+trap 'rm -f "$TMP".*' EXIT
+
+i=0
+while [ $i -lt $COUNT ]; do
+    echo "$TRUE_BIN $i"
+    i=$((i + 1))
+done > "$TMP.commands"
+
+for heap in small large; do
+    for backend in fork posix zygote; do
+        {
+            echo "spawn $backend"
+            # About 20 MB of variable text, touched, before the timed part
+            if [ $heap = large ]; then echo "BIG=\$($SEQ_BIN 1 3000000)"; fi
+            echo "T0=\$(/bin/date +%s%N)"
+            cat "$TMP.commands"
+            echo "/bin/date +%s%N > $TMP.end"
+            echo "/bin/echo \$T0 > $TMP.start"
+        } > "$TMP.script"
+
+        "$SHELL_BIN" "$TMP.script" > /dev/null
+        start=$(cat "$TMP.start")
+        end=$(cat "$TMP.end")
+        awk -v name="$backend" -v heap=$heap -v n=$COUNT -v ns=$((end - start)) 'BEGIN {
+            printf "{\"suite\":\"spawn\",\"name\":\"%s\",\"heap\":\"%s\",\"commands\":%d,", name, heap, n
+            printf "\"seconds\":%.4f,\"launches_per_sec\":%.0f}\n", ns / 1e9, n / (ns / 1e9)
+        }'
+    done
+done
@@ -1,8 +1,8 @@
 #ifndef SHELL_H
 #define SHELL_H
-#define MAX_JOBS 100
-#define MAX_BLOCK_LINES 50
-#define MAX_VARIABLES 100
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // pipe2(), O_CLOEXEC and friends
+#endif
 #include <stdio.h>
 #include <string.h>
 #include <fcntl.h>
@@ -10,82 +10,326 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 #include <errno.h>
 #include <ctype.h>
 #include <errno.h>
 #include <readline/readline.h>
 #include <readline/history.h>
 #include <dirent.h>
+#include <time.h>
+#include <sched.h>
 
 #define MAX_LEN 512
-#define MAXARGS 10
-#define ARGLEN 30
 #define PROMPT "FCIT> "
-#define HISTORY_SIZE 20
+#define HISTORY_SIZE 256       // in-memory ring; the history file keeps everything
 
-// History support
-extern char* history[HISTORY_SIZE];
-extern int history_count;
+// Per-command arena (arena.c)
+typedef struct arena_block {
+    struct arena_block* next;
+    size_t size;
+    size_t used;
+    char data[];
+} arena_block_t;
 
-// Feature 7: if-then-else-fi support
 typedef struct {
-    char* then_block[MAX_BLOCK_LINES];
-    char* else_block[MAX_BLOCK_LINES];
-    int then_count;
-    int else_count;
-    char* condition_cmd;
-} if_block_t;
-
-// Feature 8: Shell Variables - Linked List Node
+    arena_block_t* head;
+    arena_block_t* current;
+} arena_t;
+
+typedef struct {
+    arena_block_t* block;
+    size_t used;
+} arena_mark_t;
+
+extern arena_t cmd_arena;
+
+// Feature 7: if-then-else-fi support, parsed once into a command tree
+enum { NODE_SIMPLE, NODE_IF, NODE_LIST };
+
+// Command lists (main.c): how a command is joined to the one after it
+typedef enum { JOIN_SEQ, JOIN_AND, JOIN_OR, JOIN_BG } join_t;
+
+typedef struct {
+    char* text;                     // view into the line, trimmed
+    join_t join;
+} list_cmd_t;
+
+typedef struct cmd_node {
+    int type;
+    char** words;                   // NODE_SIMPLE: tokenized, not yet expanded
+    list_cmd_t* cmds;               // NODE_LIST: commands joined by ; && || &
+    int ncmds;
+    char** cond;                    // NODE_IF: condition words
+    struct cmd_node* then_list;
+    struct cmd_node* else_list;
+    struct cmd_node* next;          // next command in the same branch
+} cmd_node_t;
+
+// Feature 8: Shell Variables - hash table slot (variables.c)
 typedef struct var_node {
-    char* name;
+    char* name;             // NULL = empty slot
     char* value;
-    struct var_node* next;
+    unsigned int hash;
+    char* entry;            // "name=value" while exported, else NULL
 } var_node_t;
 
-// Background jobs (Feature 6)
+// Background jobs (Feature 6): one job per background pipeline (jobs.c).
+// Foreground pipelines are tracked in the same table while they run.
 typedef struct {
-    pid_t pid;
-    char cmd[256];
+    pid_t pid;              // -1: the stage could not be started
+    int pidfd;              // -1 when waiting falls back to SIGCHLD
+    int remote;             // the zygote reports its exit (zygote.c)
+    char* name;             // argv[0], for PATH cache invalidation
+    char* place;            // CPU placement label, NULL if not placed
+    int status;
+    int done;
+} job_proc_t;
+
+typedef struct {
+    int in_use;
+    int next_free;          // free-list link while !in_use
+    char* cmd;
+    job_proc_t* procs;      // one per stage, in pipeline order
+    int nprocs;
+    int running;            // stages not yet reaped
+    int status;             // last stage's exit status
+    int done;
+    int foreground;         // waited for by execute(), never listed
+    int collected;          // already returned by jobs_wait_any()
+    unsigned long finish_seq;
+    struct rusage usage;    // all stages, summed
+    struct timespec start;
+    struct timespec end;
 } job_t;
 
-extern job_t jobs_list[MAX_JOBS];
-extern int jobs_count;
+// CPU set a stage is pinned to (placement.c)
+typedef struct {
+    cpu_set_t cpus;
+    char label[32];         // shown by "jobs": cpu3, node1, 0-3
+} placement_t;
+
+// Pipelines: one stage per "|"-separated command
+typedef struct {
+    char** argv;
+    char* input_file;
+    char* output_file;
+    int remote;             // started by the zygote, not a child of the shell
+    const placement_t* place;   // NULL: wherever the scheduler puts it
+    int start_status;       // exit status if it could not be started
+} stage_t;
+
+// Built-in command table entry (builtins.c)
+typedef struct {
+    const char* name;
+    int (*fn)(char** argv);     // returns the exit status
+    int (*applies)(char** argv);    // NULL, or 0 to leave argv to exec
+    int pure;                   // touches no shell state: $(...) runs it in-process
+} builtin_t;
+
+// Resources used by one command: children collected with wait4() plus
+// the shell's own share (usage.c)
+typedef struct {
+    double wall;
+    double user;
+    double sys;
+    long maxrss_kb;
+    long nvcsw;
+    long nivcsw;
+} cmd_usage_t;
+
+typedef struct {
+    struct timespec start;
+    struct rusage self;
+} usage_probe_t;
+
+// Spawn backends (spawn.c)
+#define SPAWN_FORK 0
+#define SPAWN_POSIX 1
+#define SPAWN_ZYGOTE 2
+#define ZYGOTE_UNAVAILABLE (-2)     // zygote_spawn(): use a direct backend
+
+extern int spawn_mode;
+
+// Trace events (trace.c); TRACE() costs one test while tracing is off
+enum { TRACE_COMMAND, TRACE_TOKENIZE, TRACE_EXPAND, TRACE_SPAWN, TRACE_CHILD, TRACE_WAIT };
+#define TRACE_BEGIN 0
+#define TRACE_END 1
+#define TRACE(type, phase, pid) \
+    do { if (trace_enabled) trace_record((type), (phase), (pid)); } while (0)
 
-// Feature 8: Variables linked list head
-extern var_node_t* variables_head;
+extern int trace_enabled;
+
+// Operator tokens returned by tokenize(), compared by address (shell.c)
+extern char OP_PIPE[], OP_IN[], OP_OUT[], OP_BG[];
 
 // Function prototypes from shell.c
 char** tokenize(char* cmdline);
-int handle_builtin(char** args);
+int is_operator(const char* arg);
 void initialize_readline();
-void reap_background_jobs();
 char** my_completion(const char* text, int start, int end);
 
 // Function prototypes from main.c
-int execute(char** arglist);
-void add_to_history(const char* cmdline);
+extern int last_status;
+void run_command_line(char* cmdline);
+void run_command_string(char* text);
 int handle_bang_command(char** cmdline_ptr);
 
 // Function prototypes from execute.c
 int execute(char** arglist);
+int parse_pipeline(char** arglist, stage_t** stages_out);
+int launch_pipeline(stage_t* stages, int nstages, pid_t* pids);
+int wait_pipeline(stage_t* stages, pid_t* pids, int nstages);
+int run_command(char** arglist);
+
+// Function prototypes from jobs.c
+void jobs_init();
+int jobs_event_fd();
+int jobs_add(stage_t* stages, pid_t* pids, int nstages, int foreground);
+int reap_background_jobs();
+int jobs_wait_job(int job, int timeout_ms);
+int jobs_wait_any(int timeout_ms, int* status_out);
+int jobs_wait_all(int timeout_ms);
+int jobs_wait_next(const int* jobs, int njobs, int* status_out);
+int jobs_collect(int job, int* stage_status);
+int jobs_is_background(int job);
+void jobs_release(int job);
+int jobs_notify(int print);
+void jobs_print();
+void jobs_free();
+void jobs_watch_zygote(int fd);
+int jobs_remote_exit(pid_t pid, int status, const struct rusage* ru);
+void jobs_fail_remote(int status);
+void jobs_forked_child();
+
+// Function prototypes from input.c
+int input_interactive();
+void input_open_string(const char* text);
+int input_open_file(const char* path);
+void input_open_stdin();
+int input_from_stdin();
+char* read_input_line(const char* prompt);
+void input_close();
+
+// Function prototypes from history.c
+void history_init();
+void add_to_history(const char* cmdline);
+char* history_dup(long n);
+long history_total();
+void history_print(long count);
+void history_close();
+
+// Function prototypes from arena.c
+void* arena_alloc(arena_t* arena, size_t size);
+char* arena_strdup(arena_t* arena, const char* str);
+char* arena_strndup(arena_t* arena, const char* str, size_t len);
+arena_mark_t arena_mark(arena_t* arena);
+void arena_release(arena_t* arena, arena_mark_t mark);
+void arena_reset(arena_t* arena);
+void arena_free(arena_t* arena);
+
+// Function prototypes from builtins.c
+const builtin_t* find_builtin(char** argv);
+const builtin_t* builtin_list();
+int handle_builtin(char** args);
+void shell_cleanup();
+
+// Function prototypes from parallel.c
+int builtin_parallel(char** argv);
+
+// Function prototypes from usage.c
+void rusage_add(struct rusage* total, const struct rusage* ru);
+void usage_add_child(const struct rusage* ru);
+void usage_begin(usage_probe_t* probe);
+void usage_end(const usage_probe_t* probe, cmd_usage_t* out);
+void usage_report(const cmd_usage_t* u);
+int stats_recording();
+char* stats_command_text(char** argv);
+void stats_record(char* text, int status, const cmd_usage_t* usage);
+int builtin_stats(char** argv);
+void stats_free();
+
+// Function prototypes from fastcopy.c
+int copy_fd(int in, int out);
+int cat_applies(char** argv);
+int builtin_cat(char** argv);
+int tee_applies(char** argv);
+int builtin_tee(char** argv);
+
+// Function prototypes from spawn.c
+pid_t spawn_stage(stage_t* st, int in_fd, int out_fd, int next_fd);
+const char* spawn_mode_name(int mode);
+int set_spawn_mode(const char* name);
+
+// Function prototypes from trace.c
+void trace_record(int type, int phase, pid_t pid);
+void trace_command(const char* text);
+int builtin_trace(char** argv);
+void trace_free();
+
+// Function prototypes from placement.c
+void placement_assign(stage_t* stages, int nstages);
+void placement_apply(pid_t pid, const cpu_set_t* cpus);
+int builtin_place(char** argv);
+void placement_free();
+
+// Function prototypes from zygote.c
+int zygote_running();
+int zygote_start();
+int zygote_dispatch();
+int zygote_take_exit(pid_t pid, int* status, struct rusage* usage);
+pid_t zygote_spawn(const char* path, char** argv, int in_fd, int out_fd, const cpu_set_t* cpus, int* err);
+void zygote_forget();
+void zygote_stop();
+int zygote_main(int sock);
+
+// Function prototypes from subst.c
+const char* skip_substitution(const char* p);
+void expand_word(const char* word, char*** list, int* count, int* capacity);
+char* expand_assignment_value(const char* text);
+
+// Function prototypes from pathglob.c
+int has_glob_chars(const char* word);
+void glob_word(const char* pattern, char*** list, int* count, int* capacity);
+void glob_cache_free();
+
+// Function prototypes from complete.c
+char* command_generator(const char* text, int state);
+int is_command_position(const char* line, int start);
+
+// Function prototypes from pathhash.c
+const char* shell_path();
+const char* path_lookup(const char* name);
+void path_forget(const char* name);
+void path_cache_clear();
+void path_cache_print();
 
 // Feature 7: if-then-else-fi functions (main.c)
 int is_if_statement(const char* cmd);
 int is_keyword(const char* line, const char* keyword);
 void trim_string(char* str);
-int read_if_block(if_block_t* block);
-int execute_condition(const char* cmd);
-void execute_block(char** block, int count);
-int execute_if_block(if_block_t* block);
+cmd_node_t* parse_if_block(char* cond_text);
+int execute_condition(char** words);
+void execute_command_list(cmd_node_t* list);
+int execute_if_node(cmd_node_t* node);
 int handle_if_statement(char* cmdline);
+int handle_assignment(const char* cmd);
+int run_words(char** words, int background);
 
-// Feature 8: Shell Variables functions (shell.c)
+// Feature 8: Shell Variables functions (variables.c, shell.c)
+unsigned int fnv1a(const char* text);
 var_node_t* find_variable(const char* name);
 void set_variable(const char* name, const char* value);
 void print_all_variables();
 void free_all_variables();
-int is_assignment(const char* cmd);
+void export_variable(const char* name, const char* value);
+void unexport_variable(const char* name);
+void print_exported_variables();
+char** shell_envp();
+void set_env_overlay(char** envp);
+void clear_env_overlay();
+int is_assignment_word(const char* word);
 char** expand_variables(char** arglist);
 
 #endif // SHELL_H
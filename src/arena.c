@@ -0,0 +1,93 @@
+/* arena.c
+ * Contains: Bump allocator for the per-command parse/expand lifecycle
+ * Everything tokenize(), expand_variables() and the if-block executor
+ * produce for one command lives in cmd_arena and is released at once by
+ * arena_reset() when the command finishes. Blocks are kept across resets,
+ * so steady-state parsing does no malloc() at all.
+ * Called by: shell.c (tokenize, expand_variables), main.c (main loop, if blocks)
+ */
+
+#include "shell.h"
+
+#define ARENA_BLOCK_SIZE 16384
+#define ARENA_ALIGN 16
+
+arena_t cmd_arena = { NULL, NULL };
+
+static arena_block_t* new_block(size_t min_size) {
+    size_t size = min_size > ARENA_BLOCK_SIZE ? min_size : ARENA_BLOCK_SIZE;
+    arena_block_t* block = (arena_block_t*)malloc(sizeof(arena_block_t) + size);
+    if (block == NULL) {
+        perror("arena: malloc failed");
+        exit(1);
+    }
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+void* arena_alloc(arena_t* arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    if (arena->current == NULL) {
+        arena->head = arena->current = new_block(size);
+    }
+
+    // Reuse blocks kept from earlier commands before allocating new ones
+    while (arena->current->used + size > arena->current->size) {
+        if (arena->current->next == NULL) {
+            arena->current->next = new_block(size);
+        }
+        arena->current = arena->current->next;
+        arena->current->used = 0;
+    }
+
+    void* ptr = arena->current->data + arena->current->used;
+    arena->current->used += size;
+    return ptr;
+}
+
+char* arena_strndup(arena_t* arena, const char* str, size_t len) {
+    char* copy = (char*)arena_alloc(arena, len + 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+char* arena_strdup(arena_t* arena, const char* str) {
+    return arena_strndup(arena, str, strlen(str));
+}
+
+// Remembers the current position so nested work (one line of an if
+// block) can be thrown away without touching the enclosing command
+arena_mark_t arena_mark(arena_t* arena) {
+    arena_mark_t mark;
+    mark.block = arena->current;
+    mark.used = arena->current ? arena->current->used : 0;
+    return mark;
+}
+
+void arena_release(arena_t* arena, arena_mark_t mark) {
+    if (mark.block == NULL) {
+        arena_reset(arena);
+        return;
+    }
+    arena->current = mark.block;
+    arena->current->used = mark.used;
+}
+
+void arena_reset(arena_t* arena) {
+    arena->current = arena->head;
+    if (arena->current) arena->current->used = 0;
+}
+
+void arena_free(arena_t* arena) {
+    arena_block_t* block = arena->head;
+    while (block != NULL) {
+        arena_block_t* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = arena->current = NULL;
+}
@@ -0,0 +1,453 @@
+/* builtins.c
+ * Contains: Built-in command table and handler (Features 1, 4, 6, 8)
+ * Built-ins run inside the shell: no fork, no exec. That includes the
+ * trivial utilities scripts call most (echo, printf, true, false, pwd, :),
+ * and plain cat/tee, whose copies go through splice/copy_file_range.
+ * A built-in with < or > gets its stdin/stdout swapped for the duration of
+ * the call and restored afterwards. In a pipeline or with '&' it runs in a
+ * forked child instead (spawn.c), since it has to run concurrently.
+ * Called by: main.c (main loop, if blocks), spawn.c (pipeline stages)
+ */
+
+#include "shell.h"
+
+// ============ SHELL BUILT-INS ============
+
+// Releases everything the shell holds; every way out goes through here
+// (end of input in main(), the exit built-in)
+void shell_cleanup() {
+    free_all_variables();
+    arena_free(&cmd_arena);
+    jobs_free();
+    zygote_stop();
+    trace_free();
+    placement_free();
+    stats_free();
+    glob_cache_free();
+    history_close();
+    input_close();
+}
+
+static int builtin_exit(char** argv) {
+    int code = argv[1] ? atoi(argv[1]) : last_status;
+    if (input_interactive()) printf("Exiting shell...\n");
+    fflush(stdout);
+    shell_cleanup();
+    exit(code);
+}
+
+static int builtin_cd(char** argv) {
+    if (argv[1] == NULL) {
+        fprintf(stderr, "cd: missing argument\n");
+        return 1;
+    }
+    if (chdir(argv[1]) != 0) {
+        perror("cd failed");
+        return 1;
+    }
+    return 0;
+}
+
+static int builtin_help(char** argv) {
+    printf("Built-in commands:\n");
+    printf("  cd <dir>            - Change directory\n");
+    printf("  help                - Show this help message\n");
+    printf("  exit [n]            - Exit the shell with status n\n");
+    printf("  jobs                - List background jobs\n");
+    printf("  wait [-n] [-t secs] [%%job..]\n");
+    printf("                      - Wait for jobs (-n: the next one), with a timeout\n");
+    printf("  history [n]         - Show the last n (default 20) commands\n");
+    printf("  set                 - Show all variables\n");
+    printf("  export [-n] [name[=value]..]\n");
+    printf("                      - Pass variables to commands (-n: stop); none: list\n");
+    printf("  spawn [fork|posix|zygote]\n");
+    printf("                      - Show or select the process spawn backend\n");
+    printf("  hash [-r] [name..]  - Show, reset or fill the command location cache\n");
+    printf("  echo [-n] [args]    - Print arguments\n");
+    printf("  printf fmt [args]   - Formatted output\n");
+    printf("  pwd                 - Print the working directory\n");
+    printf("  true, false, :      - Return success / failure / success\n");
+    printf("  parallel [-j N] cmd [args] [::: inputs]\n");
+    printf("                      - Run cmd once per input, N at a time\n");
+    printf("  time cmd [| cmd..]  - Report wall/user/sys time, max RSS, context switches\n");
+    printf("  stats [on|off|dump|clear]\n");
+    printf("                      - Record resource usage for every command\n");
+    printf("  trace [on|off|clear|dump]\n");
+    printf("                      - Record a timeline of parse/spawn/wait events (dump: Chrome trace JSON)\n");
+    printf("  place [off|rr|numa|mask CPU-LIST]\n");
+    printf("                      - Pin background jobs and pipeline stages to CPUs\n");
+    printf("  cat [files], tee [-a] [files]\n");
+    printf("                      - Copied in-kernel; other options run the real tool\n");
+    return 0;
+}
+
+// Feature 6
+static int builtin_jobs(char** argv) {
+    reap_background_jobs();
+    jobs_print();
+    return 0;
+}
+
+// wait [-n] [-t seconds] [%job ...]: block on background jobs. A job
+// waited for by number or with -n is removed from the table (no Done
+// notice). Returns the job's status, 124 on timeout, 127 for no job.
+static int builtin_wait(char** argv) {
+    int next = 0;
+    int timeout_ms = -1;
+    int i = 1;
+
+    for (; argv[i] != NULL && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-n") == 0) {
+            next = 1;
+        } else if (strcmp(argv[i], "-t") == 0 && argv[i + 1] != NULL) {
+            timeout_ms = (int)(strtod(argv[++i], NULL) * 1000);
+            if (timeout_ms < 0) timeout_ms = 0;
+        } else {
+            fprintf(stderr, "Usage: wait [-n] [-t seconds] [%%job ...]\n");
+            return 2;
+        }
+    }
+
+    if (next) {
+        int status;
+        int job = jobs_wait_any(timeout_ms, &status);
+        if (job == 0) return 124;
+        if (job < 0) return 127;
+        jobs_release(job);
+        return status;
+    }
+
+    if (argv[i] == NULL) {
+        return jobs_wait_all(timeout_ms) ? 0 : 124;
+    }
+
+    int status = 0;
+    for (; argv[i] != NULL; i++) {
+        int job = atoi(argv[i][0] == '%' ? argv[i] + 1 : argv[i]);
+        if (!jobs_is_background(job)) {
+            fprintf(stderr, "wait: %s: no such job\n", argv[i]);
+            status = 127;
+            continue;
+        }
+        if (jobs_wait_job(job, timeout_ms) == 0) return 124;
+        status = jobs_collect(job, NULL);
+    }
+    return status;
+}
+
+// Feature 4
+static int builtin_history(char** argv) {
+    history_print(argv[1] ? atol(argv[1]) : 0);
+    return 0;
+}
+
+// Feature 8
+static int builtin_set(char** argv) {
+    print_all_variables();
+    return 0;
+}
+
+static int is_variable_name(const char* name) {
+    if (!isalpha((unsigned char)*name) && *name != '_') return 0;
+    while (isalnum((unsigned char)*name) || *name == '_') name++;
+    return *name == '\0';
+}
+
+// export [-n] [name[=value] ...]: exported variables go to every command
+// started after this; -n takes them out again. No names: list them.
+static int builtin_export(char** argv) {
+    int unexport = argv[1] != NULL && strcmp(argv[1], "-n") == 0;
+    char** names = argv + 1 + unexport;
+    if (*names == NULL) {
+        print_exported_variables();
+        return 0;
+    }
+
+    int status = 0;
+    for (; *names != NULL; names++) {
+        char* equal_sign = strchr(*names, '=');
+        char* name = equal_sign ? arena_strndup(&cmd_arena, *names, equal_sign - *names) : *names;
+        if (!is_variable_name(name)) {
+            fprintf(stderr, "export: '%s': not a valid name\n", *names);
+            status = 1;
+        } else if (unexport) {
+            unexport_variable(name);
+        } else {
+            export_variable(name, equal_sign ? equal_sign + 1 : NULL);
+        }
+    }
+    return status;
+}
+
+// Inspect the PATH lookup cache
+static int builtin_hash(char** argv) {
+    int status = 0;
+    if (argv[1] == NULL) {
+        path_cache_print();
+    } else if (strcmp(argv[1], "-r") == 0) {
+        path_cache_clear();
+    } else {
+        for (int i = 1; argv[i] != NULL; i++) {
+            if (path_lookup(argv[i]) == NULL) {
+                fprintf(stderr, "hash: %s: not found\n", argv[i]);
+                status = 1;
+            }
+        }
+    }
+    return status;
+}
+
+// Select how external commands are started
+static int builtin_spawn(char** argv) {
+    if (argv[1] == NULL) {
+        printf("spawn backend: %s\n", spawn_mode_name(spawn_mode));
+    } else {
+        int err = set_spawn_mode(argv[1]);
+        if (err == -1) fprintf(stderr, "spawn: unknown backend '%s' (use fork, posix or zygote)\n", argv[1]);
+        if (err != 0) return 1;
+    }
+    return 0;
+}
+
+// ============ IN-PROCESS UTILITIES ============
+
+static int builtin_true(char** argv) {
+    return 0;
+}
+
+static int builtin_false(char** argv) {
+    return 1;
+}
+
+static int builtin_echo(char** argv) {
+    int newline = 1;
+    int i = 1;
+    if (argv[1] != NULL && strcmp(argv[1], "-n") == 0) {
+        newline = 0;
+        i++;
+    }
+    for (int first = i; argv[i] != NULL; i++) {
+        if (i > first) putchar(' ');
+        fputs(argv[i], stdout);
+    }
+    if (newline) putchar('\n');
+    return 0;
+}
+
+static int builtin_pwd(char** argv) {
+    char* cwd = getcwd(NULL, 0);
+    if (cwd == NULL) {
+        perror("pwd");
+        return 1;
+    }
+    printf("%s\n", cwd);
+    free(cwd);
+    return 0;
+}
+
+// Writes one backslash escape from a printf format; returns chars consumed
+static int print_escape(const char* p) {
+    switch (p[1]) {
+        case 'n': putchar('\n'); return 2;
+        case 't': putchar('\t'); return 2;
+        case 'r': putchar('\r'); return 2;
+        case 'a': putchar('\a'); return 2;
+        case '\\': putchar('\\'); return 2;
+        case '\0': putchar('\\'); return 1;
+        default: putchar('\\'); putchar(p[1]); return 2;
+    }
+}
+
+// printf FORMAT [ARGS...]: %s %b %c %d %i %u %o %x %X %% with flags, width
+// and precision; the format is reused while arguments remain, as in POSIX
+static int builtin_printf(char** argv) {
+    if (argv[1] == NULL) {
+        fprintf(stderr, "printf: usage: printf format [arguments]\n");
+        return 1;
+    }
+
+    const char* format = argv[1];
+    char** args = &argv[2];
+    int status = 0;
+
+    do {
+        int consumed = 0;
+        const char* p = format;
+        while (*p != '\0') {
+            if (*p == '\\') {
+                p += print_escape(p);
+                continue;
+            }
+            if (*p != '%') {
+                putchar(*p++);
+                continue;
+            }
+            if (p[1] == '%') {
+                putchar('%');
+                p += 2;
+                continue;
+            }
+
+            // Copy "%[flags][width][.precision]" and find the conversion
+            char spec[32];
+            size_t n = strspn(p + 1, "-+ #0123456789.") + 1;
+            if (n >= sizeof(spec) - 2 || p[n] == '\0') {
+                fputs(p, stdout);
+                break;
+            }
+            memcpy(spec, p, n);
+            char conv = p[n];
+            p += n + 1;
+
+            const char* arg = *args ? *args++ : NULL;
+            if (arg != NULL) consumed = 1;
+
+            switch (conv) {
+                case 'd': case 'i': {
+                    spec[n] = 'l'; spec[n + 1] = conv; spec[n + 2] = '\0';
+                    printf(spec, arg ? strtol(arg, NULL, 0) : 0L);
+                    break;
+                }
+                case 'u': case 'o': case 'x': case 'X': {
+                    spec[n] = 'l'; spec[n + 1] = conv; spec[n + 2] = '\0';
+                    printf(spec, arg ? strtoul(arg, NULL, 0) : 0UL);
+                    break;
+                }
+                case 'c':
+                    spec[n] = 'c'; spec[n + 1] = '\0';
+                    printf(spec, arg && arg[0] ? arg[0] : '\0');
+                    break;
+                case 'b':
+                    for (const char* b = arg ? arg : ""; *b != '\0'; ) {
+                        if (*b == '\\') b += print_escape(b);
+                        else putchar(*b++);
+                    }
+                    break;
+                case 's':
+                    spec[n] = 's'; spec[n + 1] = '\0';
+                    printf(spec, arg ? arg : "");
+                    break;
+                default:
+                    fprintf(stderr, "printf: %%%c: invalid conversion\n", conv);
+                    status = 1;
+                    break;
+            }
+        }
+        // Stop when nothing was consumed, or the format would loop forever
+        if (!consumed) break;
+    } while (*args != NULL);
+
+    return status;
+}
+
+// ============ DISPATCH TABLE ============
+
+static const builtin_t builtin_table[] = {
+    { "exit",     builtin_exit,      NULL,         0 },
+    { "cd",       builtin_cd,        NULL,         0 },
+    { "help",     builtin_help,      NULL,         1 },
+    { "jobs",     builtin_jobs,      NULL,         0 },
+    { "wait",     builtin_wait,      NULL,         0 },
+    { "history",  builtin_history,   NULL,         0 },
+    { "set",      builtin_set,       NULL,         0 },
+    { "export",   builtin_export,    NULL,         0 },
+    { "hash",     builtin_hash,      NULL,         0 },
+    { "spawn",    builtin_spawn,     NULL,         0 },
+    { "echo",     builtin_echo,      NULL,         1 },
+    { "printf",   builtin_printf,    NULL,         1 },
+    { "pwd",      builtin_pwd,       NULL,         1 },
+    { "true",     builtin_true,      NULL,         1 },
+    { "false",    builtin_false,     NULL,         1 },
+    { ":",        builtin_true,      NULL,         1 },
+    { "parallel", builtin_parallel,  NULL,         0 },
+    { "cat",      builtin_cat,       cat_applies,  1 },
+    { "tee",      builtin_tee,       tee_applies,  0 },
+    { "stats",    builtin_stats,     NULL,         0 },
+    { "trace",    builtin_trace,     NULL,         0 },
+    { "place",    builtin_place,     NULL,         0 },
+    { NULL, NULL, NULL, 0 }
+};
+
+// The whole table, ending with a NULL name (used by completion)
+const builtin_t* builtin_list() {
+    return builtin_table;
+}
+
+// Looks up argv[0]; entries with an applies() check only claim the
+// command when it accepts these arguments (e.g. cat without options)
+const builtin_t* find_builtin(char** argv) {
+    if (argv == NULL || argv[0] == NULL) return NULL;
+    for (const builtin_t* b = builtin_table; b->name != NULL; b++) {
+        if (strcmp(b->name, argv[0]) != 0) continue;
+        if (b->applies != NULL && !b->applies(argv)) return NULL;
+        return b;
+    }
+    return NULL;
+}
+
+// ============ REDIRECTION SAVE / RESTORE ============
+
+// Points fd at file for the duration of a built-in; returns the saved
+// copy of the original fd, or -2 if the file could not be opened
+static int redirect_fd(int fd, const char* file, int flags) {
+    int file_fd = open(file, flags | O_CLOEXEC, 0644);
+    if (file_fd < 0) {
+        fprintf(stderr, "Error: cannot open %s file '%s': %s\n",
+                fd == STDIN_FILENO ? "input" : "output", file, strerror(errno));
+        return -2;
+    }
+    int saved = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+    dup2(file_fd, fd);
+    close(file_fd);
+    return saved;
+}
+
+static void restore_fd(int fd, int saved) {
+    if (saved < 0) return;
+    dup2(saved, fd);
+    close(saved);
+}
+
+// ============ BUILT-IN HANDLER ============
+
+// Runs arglist in the shell if it names a built-in, setting last_status.
+// Returns 0 (not handled) for other commands, and for built-ins in a
+// pipeline or in the background, which execute() runs in a child.
+int handle_builtin(char **arglist) {
+    if (arglist == NULL || arglist[0] == NULL)
+        return 0;
+
+    const builtin_t* builtin = find_builtin(arglist);
+    if (builtin == NULL)
+        return 0;
+
+    for (int i = 0; arglist[i] != NULL; i++) {
+        if (arglist[i] == OP_PIPE || arglist[i] == OP_BG) return 0;
+    }
+
+    stage_t* stages;
+    if (parse_pipeline(arglist, &stages) < 0) {
+        last_status = 2;
+        return 1;
+    }
+
+    int saved_in = -1, saved_out = -1;
+    if (stages[0].input_file) {
+        saved_in = redirect_fd(STDIN_FILENO, stages[0].input_file, O_RDONLY);
+    }
+    if (saved_in != -2 && stages[0].output_file) {
+        fflush(stdout);
+        saved_out = redirect_fd(STDOUT_FILENO, stages[0].output_file, O_WRONLY | O_CREAT | O_TRUNC);
+    }
+
+    if (saved_in == -2 || saved_out == -2) {
+        last_status = 1;
+    } else {
+        last_status = builtin->fn(stages[0].argv);
+    }
+
+    fflush(stdout);
+    restore_fd(STDOUT_FILENO, saved_out);
+    restore_fd(STDIN_FILENO, saved_in);
+    return 1;
+}
@@ -0,0 +1,229 @@
+/* complete.c
+ * Contains: Command-name completion for the first word of a command
+ * Every executable on PATH plus the built-in names go into one prefix
+ * trie, built on the first Tab. Later Tabs only stat() the PATH
+ * directories: the trie is rebuilt when PATH changes or a directory's
+ * mtime moves (a binary was added or removed), never rescanned otherwise.
+ * A Tab then costs one walk down the prefix and a walk over its subtree.
+ * Called by: shell.c my_completion()
+ */
+
+#include "shell.h"
+#include <sys/stat.h>
+
+#define TRIE_INITIAL 4096
+#define NAME_BUFFER 512
+
+// First-child / next-sibling trie; siblings are kept in byte order so
+// matches come out sorted. Node 0 is the root.
+typedef struct {
+    int child;
+    int sibling;
+    unsigned char c;
+    unsigned char terminal;
+} trie_node_t;
+
+typedef struct {
+    char* path;
+    struct timespec mtime;
+    int present;
+} path_dir_t;
+
+static trie_node_t* nodes = NULL;
+static int nnodes = 0;
+static int nodes_capacity = 0;
+
+static char* trie_path_env = NULL;      // PATH the trie was built from
+static path_dir_t* dirs = NULL;
+static int ndirs = 0;
+
+// Matches handed out by command_generator(), readline frees the strings
+static char** matches = NULL;
+static int nmatches = 0;
+static int matches_capacity = 0;
+static int next_match = 0;
+
+static int new_node(unsigned char c) {
+    if (nnodes == nodes_capacity) {
+        int new_capacity = nodes_capacity ? nodes_capacity * 2 : TRIE_INITIAL;
+        trie_node_t* bigger = (trie_node_t*)realloc(nodes, sizeof(trie_node_t) * new_capacity);
+        if (bigger == NULL) return -1;
+        nodes = bigger;
+        nodes_capacity = new_capacity;
+    }
+    nodes[nnodes].child = -1;
+    nodes[nnodes].sibling = -1;
+    nodes[nnodes].c = c;
+    nodes[nnodes].terminal = 0;
+    return nnodes++;
+}
+
+static void trie_insert(const char* name) {
+    int node = 0;
+    for (const unsigned char* p = (const unsigned char*)name; *p != '\0'; p++) {
+        // Find or insert *p among node's children, keeping byte order
+        int* link = &nodes[node].child;
+        while (*link != -1 && nodes[*link].c < *p) link = &nodes[*link].sibling;
+        if (*link == -1 || nodes[*link].c != *p) {
+            int added = new_node(*p);
+            if (added < 0) return;
+            nodes[added].sibling = *link;
+            *link = added;
+        }
+        node = *link;
+    }
+    nodes[node].terminal = 1;
+}
+
+static int stat_dir(path_dir_t* dir) {
+    struct stat sb;
+    if (stat(dir->path, &sb) < 0 || !S_ISDIR(sb.st_mode)) {
+        dir->present = 0;
+        return 0;
+    }
+    dir->present = 1;
+    dir->mtime = sb.st_mtim;
+    return 1;
+}
+
+static void scan_dir(path_dir_t* dir) {
+    if (!stat_dir(dir)) return;
+    DIR* d = opendir(dir->path);
+    if (d == NULL) return;
+
+    int dfd = dirfd(d);
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        if (entry->d_type == DT_DIR) continue;
+        if (faccessat(dfd, entry->d_name, X_OK, 0) != 0) continue;
+        trie_insert(entry->d_name);
+    }
+    closedir(d);
+}
+
+static void free_dirs() {
+    for (int i = 0; i < ndirs; i++) free(dirs[i].path);
+    free(dirs);
+    dirs = NULL;
+    ndirs = 0;
+}
+
+static void build_trie(const char* path_env) {
+    nnodes = 0;
+    new_node('\0');
+    free_dirs();
+    free(trie_path_env);
+    trie_path_env = strdup(path_env);
+
+    int count = 1;
+    for (const char* p = path_env; *p != '\0'; p++) {
+        if (*p == ':') count++;
+    }
+    dirs = (path_dir_t*)calloc(count, sizeof(path_dir_t));
+    if (dirs == NULL) return;
+
+    const char* start = path_env;
+    while (1) {
+        const char* colon = strchr(start, ':');
+        size_t len = colon ? (size_t)(colon - start) : strlen(start);
+        // An empty PATH element means the current directory
+        dirs[ndirs].path = len ? strndup(start, len) : strdup(".");
+        scan_dir(&dirs[ndirs]);
+        ndirs++;
+        if (colon == NULL) break;
+        start = colon + 1;
+    }
+
+    for (const builtin_t* b = builtin_list(); b->name != NULL; b++) {
+        trie_insert(b->name);
+    }
+    trie_insert("time");
+    trie_insert("if");
+}
+
+// Rebuilds the trie if it was never built, PATH changed, or a directory
+// on it was modified since the last scan
+static void refresh_trie() {
+    const char* path_env = shell_path();
+    if (nodes == NULL || nnodes == 0 || trie_path_env == NULL
+        || strcmp(trie_path_env, path_env) != 0) {
+        build_trie(path_env);
+        return;
+    }
+
+    for (int i = 0; i < ndirs; i++) {
+        path_dir_t now = dirs[i];
+        stat_dir(&now);
+        if (now.present != dirs[i].present
+            || now.mtime.tv_sec != dirs[i].mtime.tv_sec
+            || now.mtime.tv_nsec != dirs[i].mtime.tv_nsec) {
+            build_trie(path_env);
+            return;
+        }
+    }
+}
+
+static void push_match(const char* name) {
+    if (nmatches == matches_capacity) {
+        int new_capacity = matches_capacity ? matches_capacity * 2 : 64;
+        char** bigger = (char**)realloc(matches, sizeof(char*) * new_capacity);
+        if (bigger == NULL) return;
+        matches = bigger;
+        matches_capacity = new_capacity;
+    }
+    char* copy = strdup(name);
+    if (copy != NULL) matches[nmatches++] = copy;
+}
+
+// Depth-first walk below node; buf holds the name so far (len bytes)
+static void collect(int node, char* buf, int len) {
+    if (nodes[node].terminal) {
+        buf[len] = '\0';
+        push_match(buf);
+    }
+    if (len + 1 >= NAME_BUFFER) return;
+    for (int child = nodes[node].child; child != -1; child = nodes[child].sibling) {
+        buf[len] = nodes[child].c;
+        collect(child, buf, len + 1);
+    }
+}
+
+// Fills the match list with every command name starting with prefix
+static void find_commands(const char* prefix) {
+    for (int i = next_match; i < nmatches; i++) free(matches[i]);
+    nmatches = 0;
+    next_match = 0;
+
+    refresh_trie();
+    if (nnodes == 0) return;
+
+    int node = 0;
+    for (const unsigned char* p = (const unsigned char*)prefix; *p != '\0'; p++) {
+        int child = nodes[node].child;
+        while (child != -1 && nodes[child].c != *p) child = nodes[child].sibling;
+        if (child == -1) return;
+        node = child;
+    }
+
+    char buf[NAME_BUFFER];
+    size_t len = strlen(prefix);
+    if (len >= NAME_BUFFER) return;
+    memcpy(buf, prefix, len);
+    collect(node, buf, len);
+}
+
+// readline generator: state 0 starts a new completion
+char* command_generator(const char* text, int state) {
+    if (state == 0) find_commands(text);
+    if (next_match >= nmatches) return NULL;
+    return matches[next_match++];
+}
+
+// True when the word starting at offset start of line is in command
+// position: first on the line, or right after | ; or &
+int is_command_position(const char* line, int start) {
+    int i = start - 1;
+    while (i >= 0 && (line[i] == ' ' || line[i] == '\t')) i--;
+    return i < 0 || line[i] == '|' || line[i] == ';' || line[i] == '&';
+}
@@ -1,214 +1,215 @@
 /* execute.c
  * Contains: Command execution engine
  * Features: 1 (basic), 2 (I/O redirection), 3 (piping), 6 (background jobs)
- * Called by: main.c execute_block(), main.c handle_builtin()
- * Calls: fork(), execvp(), waitpid(), dup2(), open(), close()
- * Global variables: Uses jobs_list[], jobs_count from main.c (extern)
- * Note: NO MODIFICATIONS for Features 7 & 8 - unchanged
+ * Called by: main.c main loop, execute_command_list(), execute_condition()
+ * Calls: spawn.c spawn_stage(), pipe2(), close(); jobs.c to wait
+ * Background pipelines are registered with jobs.c jobs_add()
+ * CPU placement (placement.c) is chosen here, applied by the spawn backend
+ * Pipelines: any number of stages "a | b | c ..." joined by N-1 pipes,
+ *            each stage with its own < and > redirections
  */
 
 #include "shell.h"
 
-int execute(char* arglist[]) {
-    int status;
-    int run_in_background = 0;
+// ============ PIPELINE PARSING ============
 
-    // --- Step 0: Check for '&' at the end ---
+// Splits arglist in place at every "|" and strips the < / > operators
+// (and their file operands) out of each stage. Returns the number of
+// stages, or -1 on a syntax error. *stages_out lives in cmd_arena.
+int parse_pipeline(char** arglist, stage_t** stages_out) {
+    int nstages = 1;
     for (int i = 0; arglist[i] != NULL; i++) {
-        if (strcmp(arglist[i], "&") == 0) {
-            run_in_background = 1;
-            arglist[i] = NULL;
-            break;
-        }
+        if (arglist[i] == OP_PIPE) nstages++;
     }
 
-    // --- Step 1: Check for pipe ---
-    int pipe_index = -1;
-    for (int i = 0; arglist[i] != NULL; i++) {
-        if (strcmp(arglist[i], "|") == 0) {
-            pipe_index = i;
-            break;
+    stage_t* stages = (stage_t*)arena_alloc(&cmd_arena, sizeof(stage_t) * nstages);
+
+    int s = 0;
+    int i = 0;
+    while (s < nstages) {
+        stage_t* st = &stages[s];
+        st->argv = &arglist[i];
+        st->input_file = NULL;
+        st->output_file = NULL;
+        st->remote = 0;
+        st->place = NULL;
+        st->start_status = 0;
+
+        // Compact the stage's words over the redirections in one pass
+        int out = i;
+        while (arglist[i] != NULL && arglist[i] != OP_PIPE) {
+            if (arglist[i] == OP_IN || arglist[i] == OP_OUT) {
+                if (arglist[i+1] == NULL || is_operator(arglist[i+1])) {
+                    fprintf(stderr, "Error: missing file name after '%s'\n", arglist[i]);
+                    return -1;
+                }
+                if (arglist[i] == OP_IN) st->input_file = arglist[i+1];
+                else st->output_file = arglist[i+1];
+                i += 2;
+                continue;
+            }
+            arglist[out++] = arglist[i++];
+        }
+
+        int at_pipe = (arglist[i] != NULL);
+        arglist[out] = NULL;
+
+        if (st->argv[0] == NULL) {
+            fprintf(stderr, "Error: syntax error near '|'\n");
+            return -1;
         }
+
+        s++;
+        if (at_pipe) i++;
     }
 
-    if (pipe_index == -1) {
-        // --- No pipe: single command with I/O redirection ---
-        int cpid = fork();
-        if (cpid < 0) { perror("fork failed"); exit(1); }
-
-        if (cpid == 0) { // Child
-            char* input_file = NULL;
-            char* output_file = NULL;
-
-            // Parse < and >
-            for (int i = 0; arglist[i] != NULL; i++) {
-                if (strcmp(arglist[i], "<") == 0 && arglist[i+1] != NULL) {
-                    input_file = arglist[i+1];
-                    int j = i;
-                    while (arglist[j+2] != NULL) { arglist[j] = arglist[j+2]; j++; }
-                    arglist[j] = NULL; arglist[j+1] = NULL;
-                } else if (strcmp(arglist[i], ">") == 0 && arglist[i+1] != NULL) {
-                    output_file = arglist[i+1];
-                    int j = i;
-                    while (arglist[j+2] != NULL) { arglist[j] = arglist[j+2]; j++; }
-                    arglist[j] = NULL; arglist[j+1] = NULL;
-                }
-            }
+    *stages_out = stages;
+    return nstages;
+}
 
-            // Input redirection
-            if (input_file) {
-                int fd = open(input_file, O_RDONLY);
-                if (fd < 0) { 
-                    fprintf(stderr, "Error: cannot open input file '%s': %s\n", input_file, strerror(errno)); 
-                    exit(1); 
-                }
-                dup2(fd, STDIN_FILENO);
-                close(fd);
+// ============ PIPELINE LAUNCH ============
+
+// Starts one child per stage through the selected spawn backend, wiring
+// stage i's stdout to stage i+1's stdin. Fills pids[]; a stage that could
+// not be started gets pid -1 and its neighbours simply see EOF / EPIPE.
+// Returns -1 only if a pipe could not be created.
+int launch_pipeline(stage_t* stages, int nstages, pid_t* pids) {
+    int prev_read = -1;
+
+    // Don't let forked children inherit (and later re-flush) pending output
+    fflush(stdout);
+
+    for (int i = 0; i < nstages; i++) {
+        int fd[2] = { -1, -1 };
+        if (i < nstages - 1 && pipe2(fd, O_CLOEXEC) < 0) {
+            perror("pipe failed");
+            if (prev_read != -1) close(prev_read);
+            for (int k = 0; k < i; k++) {
+                if (pids[k] > 0) waitpid(pids[k], NULL, 0);
             }
+            return -1;
+        }
 
-            // Output redirection
-            if (output_file) {
-                int fd = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-                if (fd < 0) { 
-                    fprintf(stderr, "Error: cannot open output file '%s': %s\n", output_file, strerror(errno)); 
-                    exit(1); 
-                }
-                dup2(fd, STDOUT_FILENO);
-                close(fd);
-            }
+        pids[i] = spawn_stage(&stages[i], prev_read, fd[1], fd[0]);
 
-            execvp(arglist[0], arglist);
-            fprintf(stderr, "Error: command not found: %s\n", arglist[0]);
-            exit(1);
-        } else {
-            if (!run_in_background) {
-                waitpid(cpid, &status, 0);
-            } else {
-                printf("[Background] PID: %d\n", cpid);
-                if (jobs_count < MAX_JOBS) {
-                    jobs_list[jobs_count].pid = cpid;
-                    strncpy(jobs_list[jobs_count].cmd, arglist[0], 255);
-                    jobs_list[jobs_count].cmd[255] = '\0';
-                    jobs_count++;
-                }
-            }
+        // Parent keeps only the read end feeding the next stage
+        if (prev_read != -1) close(prev_read);
+        if (fd[1] != -1) close(fd[1]);
+        prev_read = fd[0];
+    }
 
-        }
-        return 0;
+    return nstages;
+}
+
+// Waits for every stage through the job event loop and returns the exit
+// status of the last one. Each stage's status is recorded as it exits and
+// left in $PIPESTATUS; the stages' rusage goes to the current command's
+// accounting (usage.c). A stage exiting with 127 (exec failed) drops its
+// stale PATH cache entry.
+int wait_pipeline(stage_t* stages, pid_t* pids, int nstages) {
+    int job = jobs_add(stages, pids, nstages, 1);
+    if (job < 0) return 1;
+    jobs_wait_job(job, -1);
+
+    int* stage_status = (int*)arena_alloc(&cmd_arena, sizeof(int) * nstages);
+    int status = jobs_collect(job, stage_status);
+
+    char* text = (char*)arena_alloc(&cmd_arena, nstages * 4 + 1);
+    char* p = text;
+    for (int i = 0; i < nstages; i++) {
+        p += sprintf(p, i == 0 ? "%d" : " %d", stage_status[i]);
     }
+    set_variable("PIPESTATUS", text);
+    return status;
+}
 
-    // --- Step 2: Pipe exists ---
-    char* left_cmd[pipe_index + 1];
-    char* right_cmd[MAXARGS + 1];
-
-    for (int i = 0; i < pipe_index; i++) left_cmd[i] = arglist[i];
-    left_cmd[pipe_index] = NULL;
-
-    int j = 0;
-    for (int i = pipe_index + 1; arglist[i] != NULL; i++) right_cmd[j++] = arglist[i];
-    right_cmd[j] = NULL;
-
-    // --- Step 3: Parse I/O redirection on both sides ---
-    char* left_input = NULL, *left_output = NULL;
-    char* right_input = NULL, *right_output = NULL;
-
-    // Left command
-    for (int i = 0; left_cmd[i] != NULL; i++) {
-        if (strcmp(left_cmd[i], "<") == 0 && left_cmd[i+1] != NULL) {
-            left_input = left_cmd[i+1];
-            int k = i;
-            while (left_cmd[k+2] != NULL) { left_cmd[k] = left_cmd[k+2]; k++; }
-            left_cmd[k] = NULL; left_cmd[k+1] = NULL;
-        } else if (strcmp(left_cmd[i], ">") == 0 && left_cmd[i+1] != NULL) {
-            left_output = left_cmd[i+1];
-            int k = i;
-            while (left_cmd[k+2] != NULL) { left_cmd[k] = left_cmd[k+2]; k++; }
-            left_cmd[k] = NULL; left_cmd[k+1] = NULL;
+// Announces a background pipeline (interactively) and hands it to the job table
+static void add_background_jobs(stage_t* stages, pid_t* pids, int nstages) {
+    if (!input_interactive()) {
+        // Batch mode keeps its output to what the commands print
+    } else if (nstages == 1) {
+        printf("[Background] PID: %d\n", pids[0]);
+    } else {
+        printf("[Background] PIDs:");
+        for (int i = 0; i < nstages; i++) {
+            printf("%s %d", i == 0 ? "" : ",", pids[i]);
         }
+        printf("\n");
     }
+    jobs_add(stages, pids, nstages, 0);
+}
 
-    // Right command
-    for (int i = 0; right_cmd[i] != NULL; i++) {
-        if (strcmp(right_cmd[i], "<") == 0 && right_cmd[i+1] != NULL) {
-            right_input = right_cmd[i+1];
-            int k = i;
-            while (right_cmd[k+2] != NULL) { right_cmd[k] = right_cmd[k+2]; k++; }
-            right_cmd[k] = NULL; right_cmd[k+1] = NULL;
-        } else if (strcmp(right_cmd[i], ">") == 0 && right_cmd[i+1] != NULL) {
-            right_output = right_cmd[i+1];
-            int k = i;
-            while (right_cmd[k+2] != NULL) { right_cmd[k] = right_cmd[k+2]; k++; }
-            right_cmd[k] = NULL; right_cmd[k+1] = NULL;
+// ============ EXECUTE ============
+
+int execute(char* arglist[]) {
+    int run_in_background = 0;
+    int result = 0;
+
+    // --- Step 0: Check for '&' at the end ---
+    for (int i = 0; arglist[i] != NULL; i++) {
+        if (arglist[i] == OP_BG) {
+            run_in_background = 1;
+            arglist[i] = NULL;
+            break;
         }
     }
+    if (arglist[0] == NULL) return 0;
 
-    // --- Step 4: Create pipe ---
-    int fd[2];
-    if (pipe(fd) < 0) { perror("pipe failed"); return 1; }
-
-    // --- Step 5: Left child ---
-    int left_cpid = fork();
-    if (left_cpid < 0) { perror("fork failed"); return 1; }
-    if (left_cpid == 0) {
-        if (left_input) {
-            int fd_in = open(left_input, O_RDONLY);
-            if (fd_in < 0) { fprintf(stderr, "Error: cannot open input file '%s': %s\n", left_input, strerror(errno)); exit(1); }
-            dup2(fd_in, STDIN_FILENO); close(fd_in);
-        }
-        if (left_output) {
-            int fd_out = open(left_output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-            if (fd_out < 0) { fprintf(stderr, "Error: cannot open output file '%s': %s\n", left_output, strerror(errno)); exit(1); }
-            dup2(fd_out, STDOUT_FILENO); close(fd_out);
-        } else {
-            dup2(fd[1], STDOUT_FILENO);
-        }
-        close(fd[0]); close(fd[1]);
-        execvp(left_cmd[0], left_cmd);
-        fprintf(stderr, "Error: command not found: %s\n", left_cmd[0]);
-        exit(1);
+    // --- Step 1: Split into stages ---
+    stage_t* stages;
+    int nstages = parse_pipeline(arglist, &stages);
+    if (nstages < 0) return 1;
+
+    pid_t* pids = (pid_t*)arena_alloc(&cmd_arena, sizeof(pid_t) * nstages);
+
+    // Background jobs go where the policy says
+    if (run_in_background) placement_assign(stages, nstages);
+
+    // --- Step 2: Start every stage, then wait or register as jobs ---
+    if (launch_pipeline(stages, nstages, pids) < 0) {
+        result = 1;
+    } else if (!run_in_background) {
+        result = wait_pipeline(stages, pids, nstages);
+    } else {
+        add_background_jobs(stages, pids, nstages);
     }
 
-    // --- Step 6: Right child ---
-    int right_cpid = fork();
-    if (right_cpid < 0) { perror("fork failed"); return 1; }
-    if (right_cpid == 0) {
-        if (right_input) {
-            int fd_in = open(right_input, O_RDONLY);
-            if (fd_in < 0) { fprintf(stderr, "Error: cannot open input file '%s': %s\n", right_input, strerror(errno)); exit(1); }
-            dup2(fd_in, STDIN_FILENO); close(fd_in);
-        } else {
-            dup2(fd[0], STDIN_FILENO);
-        }
-        if (right_output) {
-            int fd_out = open(right_output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-            if (fd_out < 0) { fprintf(stderr, "Error: cannot open output file '%s': %s\n", right_output, strerror(errno)); exit(1); }
-            dup2(fd_out, STDOUT_FILENO); close(fd_out);
+    return result;
+}
+
+// ============ RUN ONE COMMAND ============
+
+// Exit status of the last command run in the foreground
+int last_status = 0;
+
+// Runs expanded words as a built-in or through execute(), handling the
+// "time" prefix and per-command recording. Sets and returns last_status.
+int run_command(char** arglist) {
+    int timed = 0;
+    if (arglist[0] != NULL && strcmp(arglist[0], "time") == 0) {
+        timed = 1;
+        arglist++;
+        if (arglist[0] == NULL) {
+            fprintf(stderr, "Usage: time command [args...]\n");
+            last_status = 2;
+            return last_status;
         }
-        close(fd[0]); close(fd[1]);
-        execvp(right_cmd[0], right_cmd);
-        fprintf(stderr, "Error: command not found: %s\n", right_cmd[0]);
-        exit(1);
     }
 
-    // --- Step 7: Parent closes pipe and waits ---
-    close(fd[0]); close(fd[1]);
-    if (!run_in_background) {
-        waitpid(left_cpid, &status, 0);
-        waitpid(right_cpid, &status, 0);
-    } else {
-        printf("[Background] PIDs: %d, %d\n", left_cpid, right_cpid);
-        if (jobs_count + 2 <= MAX_JOBS) {
-            jobs_list[jobs_count].pid = left_cpid;
-            strncpy(jobs_list[jobs_count].cmd, left_cmd[0], 255);
-            jobs_list[jobs_count].cmd[255] = '\0';
-            jobs_count++;
-
-            jobs_list[jobs_count].pid = right_cpid;
-            strncpy(jobs_list[jobs_count].cmd, right_cmd[0], 255);
-            jobs_list[jobs_count].cmd[255] = '\0';
-            jobs_count++;
-        }
+    if (!timed && !stats_recording()) {
+        if (!handle_builtin(arglist)) last_status = execute(arglist);
+        return last_status;
     }
 
-    return 0;
+    char* text = stats_command_text(arglist);
+    usage_probe_t probe;
+    cmd_usage_t usage;
+
+    usage_begin(&probe);
+    if (!handle_builtin(arglist)) last_status = execute(arglist);
+    usage_end(&probe, &usage);
+
+    if (timed) usage_report(&usage);
+    stats_record(text, last_status, &usage);
+    return last_status;
 }
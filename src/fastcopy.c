@@ -0,0 +1,280 @@
+/* fastcopy.c
+ * Contains: In-kernel copy fast path for pure data-movement stages
+ * "cat [files...]" and "tee [-a] [files...]" without other options are
+ * run by the shell itself: data moves between the redirection fds and
+ * pipes with copy_file_range(), splice() or tee(), never through a user
+ * space buffer when the kernel can avoid it. Anything else (cat -n, tee
+ * -i, ...) is not claimed and falls back to exec'ing the real program.
+ * SIGPIPE is ignored while they copy, since in-process they would take
+ * the shell down with them: a closed stdout is EPIPE, and status 141 as
+ * if the real program had been killed.
+ * Called by: builtins.c dispatch table (in-process, or in a forked child
+ *            when the stage is part of a pipeline)
+ */
+
+#include "shell.h"
+#include <signal.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+
+#define COPY_CHUNK (1 << 30)
+#define RW_BUFFER 65536
+#define STATUS_SIGPIPE (128 + SIGPIPE)
+
+static int is_pipe(int fd) {
+    struct stat sb;
+    return fstat(fd, &sb) == 0 && S_ISFIFO(sb.st_mode);
+}
+
+static void ignore_sigpipe(struct sigaction* saved) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_IGN;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPIPE, &sa, saved);
+}
+
+static void restore_sigpipe(const struct sigaction* saved) {
+    sigaction(SIGPIPE, saved, NULL);
+}
+
+// Plain read/write loop; the last resort
+static int copy_rw(int in, int out) {
+    char buf[RW_BUFFER];
+    ssize_t n;
+    while ((n = read(in, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        for (ssize_t done = 0; done < n; ) {
+            ssize_t w = write(out, buf + done, n - done);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            done += w;
+        }
+    }
+    return 0;
+}
+
+// Moves everything from in to out, picking the cheapest mechanism the
+// two fds support. Returns 0, or -1 with errno set.
+int copy_fd(int in, int out) {
+    int in_pipe = is_pipe(in);
+    int out_pipe = is_pipe(out);
+    ssize_t n;
+
+    // file -> file: copy_file_range (reflink / in-kernel copy)
+    if (!in_pipe && !out_pipe) {
+        while ((n = copy_file_range(in, NULL, out, NULL, COPY_CHUNK, 0)) > 0) {}
+        if (n == 0) return 0;
+        if (errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EBADF
+            && errno != EOPNOTSUPP) return -1;
+    }
+
+    // Either side a pipe: splice moves pages without copying them out
+    if (in_pipe || out_pipe) {
+        while ((n = splice(in, NULL, out, NULL, COPY_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE)) > 0) {}
+        if (n == 0) return 0;
+        if (errno != EINVAL && errno != ENOSYS) return -1;
+    }
+
+    // file -> socket / tty / anything: sendfile still avoids user space
+    if (!in_pipe) {
+        while ((n = sendfile(out, in, NULL, COPY_CHUNK)) > 0) {}
+        if (n == 0) return 0;
+        if (errno != EINVAL && errno != ENOSYS) return -1;
+    }
+
+    return copy_rw(in, out);
+}
+
+// Claims a stage only if it has no option words other than the allowed
+// one; redirection operators and their file names are skipped
+static int only_plain_args(char** argv, const char* allowed) {
+    for (int i = 1; argv[i] != NULL; i++) {
+        if (is_operator(argv[i])) {
+            if (argv[i] != OP_PIPE && argv[i] != OP_BG && argv[i + 1] != NULL) i++;
+            continue;
+        }
+        if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            if (allowed == NULL || strcmp(argv[i], allowed) != 0) return 0;
+        }
+    }
+    return 1;
+}
+
+// ============ cat ============
+
+int cat_applies(char** argv) {
+    return only_plain_args(argv, NULL);
+}
+
+static int cat_files(char** argv) {
+    int status = 0;
+
+    if (argv[1] == NULL) {
+        if (copy_fd(STDIN_FILENO, STDOUT_FILENO) < 0) {
+            if (errno == EPIPE) return STATUS_SIGPIPE;
+            fprintf(stderr, "cat: %s\n", strerror(errno));
+            return 1;
+        }
+        return 0;
+    }
+
+    for (int i = 1; argv[i] != NULL; i++) {
+        int fd = STDIN_FILENO;
+        if (strcmp(argv[i], "-") != 0) {
+            fd = open(argv[i], O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                fprintf(stderr, "cat: %s: %s\n", argv[i], strerror(errno));
+                status = 1;
+                continue;
+            }
+        }
+        int ret = copy_fd(fd, STDOUT_FILENO);
+        int saved_errno = errno;
+        if (fd != STDIN_FILENO) close(fd);
+        if (ret < 0) {
+            if (saved_errno == EPIPE) return STATUS_SIGPIPE;
+            fprintf(stderr, "cat: %s: %s\n", argv[i], strerror(saved_errno));
+            status = 1;
+        }
+    }
+    return status;
+}
+
+int builtin_cat(char** argv) {
+    struct sigaction saved;
+    fflush(stdout);
+    ignore_sigpipe(&saved);
+    int status = cat_files(argv);
+    restore_sigpipe(&saved);
+    return status;
+}
+
+// ============ tee ============
+
+int tee_applies(char** argv) {
+    return only_plain_args(argv, "-a");
+}
+
+static int write_all(int fd, const char* buf, ssize_t n) {
+    for (ssize_t done = 0; done < n; ) {
+        ssize_t w = write(fd, buf + done, n - done);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += w;
+    }
+    return 0;
+}
+
+// Reads exactly n bytes of stdin into the file only: they are already on
+// stdout. Returns -1 if the file could not take them (they are dropped).
+static int drain_to_file(int file_fd, ssize_t n) {
+    char buf[RW_BUFFER];
+    int ret = 0;
+    while (n > 0) {
+        ssize_t got = read(STDIN_FILENO, buf, n < RW_BUFFER ? n : RW_BUFFER);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return -1;
+        if (ret == 0 && write_all(file_fd, buf, got) < 0) ret = -1;
+        n -= got;
+    }
+    return ret;
+}
+
+// Pipe in, pipe out, one file: tee(2) duplicates the pipe's pages onto
+// stdout, then splice(2) moves the same pages into the file. Returns 0
+// when stdin is done, -1 with errno set when stdout failed, or 1 when the
+// rest has to go through read/write (a splice failed; what tee() already
+// sent to stdout is written to the file first, *file_failed set if not).
+static int tee_spliced(int file_fd, int* file_failed) {
+    while (1) {
+        ssize_t n = tee(STDIN_FILENO, STDOUT_FILENO, COPY_CHUNK, 0);
+        if (n == 0) return 0;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EINVAL ? 1 : -1;
+        }
+        while (n > 0) {
+            ssize_t moved = splice(STDIN_FILENO, NULL, file_fd, NULL, n, SPLICE_F_MOVE);
+            if (moved < 0) {
+                if (errno == EINTR) continue;
+                if (drain_to_file(file_fd, n) < 0) *file_failed = 1;
+                return 1;
+            }
+            n -= moved;
+        }
+    }
+}
+
+// Copies stdin to stdout and the open files; 0, 1 if a file or stdin
+// failed, or 141 once stdout is a closed pipe
+static int tee_copy(int* fds, int nopen) {
+    int status = 0;
+    if (nopen == 1 && is_pipe(STDIN_FILENO) && is_pipe(STDOUT_FILENO)) {
+        int file_failed = 0;
+        int ret = tee_spliced(fds[0], &file_failed);
+        if (file_failed) status = 1;
+        if (ret == 0) return status;
+        if (ret < 0) return errno == EPIPE ? STATUS_SIGPIPE : 1;
+    }
+
+    // General case: one read, written to stdout and every file
+    char buf[RW_BUFFER];
+    ssize_t n;
+    while ((n = read(STDIN_FILENO, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 1;
+        }
+        if (write_all(STDOUT_FILENO, buf, n) < 0) {
+            if (errno == EPIPE) return STATUS_SIGPIPE;
+            status = 1;
+        }
+        for (int k = 0; k < nopen; k++) {
+            if (write_all(fds[k], buf, n) < 0) status = 1;
+        }
+    }
+    return status;
+}
+
+int builtin_tee(char** argv) {
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | O_TRUNC;
+    int i = 1;
+    if (argv[i] != NULL && strcmp(argv[i], "-a") == 0) {
+        flags = O_WRONLY | O_CREAT | O_CLOEXEC | O_APPEND;
+        i++;
+    }
+
+    int nfiles = 0;
+    for (int k = i; argv[k] != NULL; k++) nfiles++;
+    int* fds = (int*)arena_alloc(&cmd_arena, sizeof(int) * (nfiles + 1));
+    int status = 0;
+    int nopen = 0;
+
+    for (int k = i; argv[k] != NULL; k++) {
+        int fd = open(argv[k], flags, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "tee: %s: %s\n", argv[k], strerror(errno));
+            status = 1;
+            continue;
+        }
+        fds[nopen++] = fd;
+    }
+
+    struct sigaction saved;
+    fflush(stdout);
+    ignore_sigpipe(&saved);
+    int copied = tee_copy(fds, nopen);
+    if (copied != 0) status = copied;
+    restore_sigpipe(&saved);
+
+    for (int k = 0; k < nopen; k++) close(fds[k]);
+    return status;
+}
@@ -0,0 +1,177 @@
+/* history.c
+ * Contains: Feature 4 command history
+ * Recent commands sit in a fixed ring (O(1) add, no shifting); every
+ * command is also appended to an on-disk history file that survives exit.
+ * The file is never read at startup: the first "history" or "!n" maps it
+ * with mmap and builds an offset index in one memchr pass, after which any
+ * entry, old or new, is found in constant time by its absolute number.
+ * File: $MYSHELL_HISTFILE, or ~/.myshell_history
+ * Called by: main.c (main loop, handle_bang_command), builtins.c (history built-in)
+ */
+
+#include "shell.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#define HISTORY_FILE_NAME ".myshell_history"
+#define HISTORY_SHOW_DEFAULT 20
+
+// In-memory ring of this session's most recent commands
+static char* ring[HISTORY_SIZE];
+static long session_count = 0;          // commands added this session
+
+// On-disk store
+static int hist_fd = -1;
+static off_t hist_size = 0;             // bytes in the file we know about
+static char* hist_map = NULL;
+static size_t hist_map_len = 0;
+
+// Offset index, built on first use: entry n starts at offsets[n - 1]
+static off_t* offsets = NULL;
+static long indexed = 0;
+static long offsets_capacity = 0;
+static int index_built = 0;
+static long disk_base = 0;              // entries already in the file at startup
+
+void history_init() {
+    const char* path = getenv("MYSHELL_HISTFILE");
+    char buf[MAX_LEN];
+
+    if (path == NULL) {
+        const char* home = getenv("HOME");
+        if (home == NULL) return;
+        snprintf(buf, sizeof(buf), "%s/%s", home, HISTORY_FILE_NAME);
+        path = buf;
+    }
+
+    hist_fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (hist_fd < 0) return;    // history still works, just not persistently
+
+    struct stat sb;
+    if (fstat(hist_fd, &sb) == 0) hist_size = sb.st_size;
+}
+
+static void push_offset(off_t offset) {
+    if (indexed == offsets_capacity) {
+        long new_capacity = offsets_capacity ? offsets_capacity * 2 : 1024;
+        off_t* bigger = (off_t*)realloc(offsets, sizeof(off_t) * new_capacity);
+        if (bigger == NULL) return;
+        offsets = bigger;
+        offsets_capacity = new_capacity;
+    }
+    offsets[indexed++] = offset;
+}
+
+// Maps the whole file as it is now (again, if it grew since the last map)
+static int map_history() {
+    if (hist_map != NULL && hist_map_len == (size_t)hist_size) return 0;
+    if (hist_map != NULL) munmap(hist_map, hist_map_len);
+    hist_map = NULL;
+    hist_map_len = 0;
+    if (hist_size == 0) return 0;
+
+    void* map = mmap(NULL, hist_size, PROT_READ, MAP_PRIVATE, hist_fd, 0);
+    if (map == MAP_FAILED) return -1;
+    hist_map = (char*)map;
+    hist_map_len = hist_size;
+    return 0;
+}
+
+// One pass over the file recording where each line starts
+static void build_index() {
+    if (index_built) return;
+    index_built = 1;
+    if (hist_fd < 0) return;
+
+    // Entries this session wrote already are in the file and get indexed
+    // too, so the base is what was there before them
+    if (map_history() == 0 && hist_map != NULL) {
+        const char* p = hist_map;
+        const char* end = hist_map + hist_map_len;
+        while (p < end) {
+            const char* nl = memchr(p, '\n', end - p);
+            if (nl == NULL) break;      // ignore a torn last line
+            push_offset(p - hist_map);
+            p = nl + 1;
+        }
+    }
+    disk_base = indexed - session_count;
+    if (disk_base < 0) disk_base = 0;
+}
+
+long history_total() {
+    build_index();
+    return disk_base + session_count;
+}
+
+void add_to_history(const char* cmdline) {
+    size_t len = strlen(cmdline);
+
+    int slot = session_count % HISTORY_SIZE;
+    free(ring[slot]);
+    ring[slot] = strdup(cmdline);
+    session_count++;
+
+    if (hist_fd < 0) return;
+
+    // One append per command: the line and its newline in a single write
+    struct iovec iov[2];
+    iov[0].iov_base = (void*)cmdline;
+    iov[0].iov_len = len;
+    iov[1].iov_base = "\n";
+    iov[1].iov_len = 1;
+    if (writev(hist_fd, iov, 2) == (ssize_t)(len + 1)) {
+        if (index_built) push_offset(hist_size);
+        hist_size += len + 1;
+    }
+}
+
+// Returns a malloc'd copy of entry n (1-based, counted across sessions),
+// or NULL if there is no such entry
+char* history_dup(long n) {
+    long total = history_total();
+    if (n < 1 || n > total) return NULL;
+
+    // Still in the ring?
+    long ring_len = session_count < HISTORY_SIZE ? session_count : HISTORY_SIZE;
+    long session_index = n - disk_base - 1;
+    if (session_index >= session_count - ring_len) {
+        return strdup(ring[session_index % HISTORY_SIZE]);
+    }
+
+    // Older: read it straight out of the mapped file
+    if (n > indexed || map_history() != 0 || hist_map == NULL) return NULL;
+    off_t start = offsets[n - 1];
+    const char* nl = memchr(hist_map + start, '\n', hist_map_len - start);
+    size_t line_len = nl ? (size_t)(nl - (hist_map + start)) : hist_map_len - start;
+    return strndup(hist_map + start, line_len);
+}
+
+// Prints the last count entries with their absolute numbers
+void history_print(long count) {
+    long total = history_total();
+    if (count <= 0) count = HISTORY_SHOW_DEFAULT;
+    long first = total - count + 1;
+    if (first < 1) first = 1;
+
+    for (long n = first; n <= total; n++) {
+        char* line = history_dup(n);
+        if (line == NULL) continue;
+        printf("%ld %s\n", n, line);
+        free(line);
+    }
+}
+
+void history_close() {
+    for (int i = 0; i < HISTORY_SIZE; i++) {
+        free(ring[i]);
+        ring[i] = NULL;
+    }
+    if (hist_map != NULL) munmap(hist_map, hist_map_len);
+    hist_map = NULL;
+    free(offsets);
+    offsets = NULL;
+    if (hist_fd >= 0) close(hist_fd);
+    hist_fd = -1;
+}
@@ -0,0 +1,121 @@
+/* input.c
+ * Contains: Line sources for the main loop and the if-block reader
+ * Interactive: readline() with prompts (stdin is a TTY, no arguments)
+ * Batch: "-c <commands>" string, a script file, or non-TTY stdin. Scripts
+ *        and regular files on stdin are mmap'd and split with memchr;
+ *        pipes are read through buffered getline(). No readline, no prompts.
+ * Called by: main.c (main, parse_if_block)
+ */
+
+#include "shell.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define INPUT_READLINE 0
+#define INPUT_BUFFER 1      // -c string or mmap'd file
+#define INPUT_STREAM 2      // pipe on stdin
+
+static int input_kind = INPUT_READLINE;
+static const char* buf_cur = NULL;
+static const char* buf_end = NULL;
+static void* map_base = NULL;
+static size_t map_len = 0;
+static int map_is_stdin = 0;
+
+int input_interactive() {
+    return input_kind == INPUT_READLINE;
+}
+
+void input_open_string(const char* text) {
+    input_kind = INPUT_BUFFER;
+    buf_cur = text;
+    buf_end = text + strlen(text);
+}
+
+// Maps fd if it is a regular file; returns 0 on success
+static int map_fd(int fd) {
+    struct stat sb;
+    if (fstat(fd, &sb) < 0 || !S_ISREG(sb.st_mode)) return -1;
+
+    input_kind = INPUT_BUFFER;
+    if (sb.st_size == 0) {
+        buf_cur = buf_end = "";
+        return 0;
+    }
+
+    void* map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) return -1;
+    madvise(map, sb.st_size, MADV_SEQUENTIAL);
+    map_base = map;
+    map_len = sb.st_size;
+    buf_cur = (const char*)map;
+    buf_end = buf_cur + sb.st_size;
+    return 0;
+}
+
+int input_open_file(const char* path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "myshell: cannot open '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+    int ret = map_fd(fd);
+    close(fd);      // the mapping stays valid
+    if (ret < 0) {
+        fprintf(stderr, "myshell: cannot read '%s'\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// Uses readline only when stdin is a terminal
+void input_open_stdin() {
+    if (isatty(STDIN_FILENO)) {
+        input_kind = INPUT_READLINE;
+    } else if (map_fd(STDIN_FILENO) == 0) {
+        map_is_stdin = 1;
+    } else {
+        input_kind = INPUT_STREAM;
+    }
+}
+
+// The commands themselves come from stdin (a script piped or redirected
+// in), so a command reading stdin would eat the rest of the script
+int input_from_stdin() {
+    return input_kind == INPUT_STREAM || map_is_stdin;
+}
+
+// Returns the next line without its newline (malloc'd), or NULL at end
+// of input. The prompt is only shown in interactive mode.
+char* read_input_line(const char* prompt) {
+    if (input_kind == INPUT_READLINE) {
+        return readline(prompt);
+    }
+
+    if (input_kind == INPUT_STREAM) {
+        char* line = NULL;
+        size_t capacity = 0;
+        ssize_t len = getline(&line, &capacity, stdin);
+        if (len < 0) {
+            free(line);
+            return NULL;
+        }
+        if (len > 0 && line[len - 1] == '\n') line[len - 1] = '\0';
+        return line;
+    }
+
+    if (buf_cur >= buf_end) return NULL;
+    const char* nl = memchr(buf_cur, '\n', buf_end - buf_cur);
+    const char* line_end = nl ? nl : buf_end;
+    char* line = strndup(buf_cur, line_end - buf_cur);
+    buf_cur = nl ? nl + 1 : buf_end;
+
+    // Commands that read stdin must start after the lines consumed so far
+    if (map_is_stdin) lseek(STDIN_FILENO, buf_cur - (const char*)map_base, SEEK_SET);
+    return line;
+}
+
+void input_close() {
+    if (map_base != NULL) munmap(map_base, map_len);
+    map_base = NULL;
+}
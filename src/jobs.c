@@ -0,0 +1,660 @@
+/* jobs.c
+ * Contains: Feature 6 job table and the child event loop
+ * Jobs live in a growable slot array with a free list (no fixed cap, O(1)
+ * add/remove) plus a pid -> slot index, so a finished child is matched to
+ * its job in O(1). Foreground pipelines are entered in the same table
+ * while execute() waits for them, so one loop watches every child.
+ * Event loop: each child gets a pidfd (pidfd_open) registered with one
+ * epoll instance; a stage is reaped with wait4() the moment its pidfd
+ * becomes readable, and its status recorded right away. Kernels without
+ * pidfds fall back to a SIGCHLD self-pipe in the same epoll set. The
+ * epoll fd is what the prompt (readline's getc hook) selects on.
+ * Children started by the zygote are not ours to wait for: their exits
+ * arrive as messages on its socket, which is one more source in the set.
+ * Called by: execute.c (jobs_add, waiting), shell.c (getc hook),
+ *            builtins.c (jobs, wait), parallel.c, main.c
+ */
+
+#include "shell.h"
+#include <signal.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+
+#define EVENT_BATCH 64
+#define SIGCHLD_TOKEN 0         // epoll data for the self-pipe; no pid is 0
+#define ZYGOTE_TOKEN UINT64_MAX // epoll data for the zygote's socket
+
+static job_t* job_slots = NULL;
+static int job_capacity = 0;
+static int job_free_head = -1;      // first free slot, chained via next_free
+
+// pid -> slot index (open addressing; pid 0 = empty, -1 = deleted)
+typedef struct {
+    pid_t pid;
+    int slot;
+} pid_index_t;
+
+static pid_index_t* pid_index = NULL;
+static int pid_index_capacity = 0;  // power of two
+static int pid_index_used = 0;      // live + deleted entries
+
+static int sigchld_pipe[2] = { -1, -1 };
+static int epoll_fd = -1;
+static int use_pidfd = 0;
+static unsigned long finish_counter = 0;
+
+// ============ EVENT SOURCES ============
+
+static void sigchld_handler(int sig) {
+    int saved_errno = errno;
+    char byte = 0;
+    (void)sig;
+    if (write(sigchld_pipe[1], &byte, 1) < 0) {
+        // Pipe full: a wakeup is already pending, nothing is lost
+    }
+    errno = saved_errno;
+}
+
+static int open_pidfd(pid_t pid) {
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+}
+
+void jobs_init() {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("epoll_create1 failed");
+        return;
+    }
+
+    // Probe once: pidfds need Linux 5.3+
+    int probe = open_pidfd(getpid());
+    if (probe >= 0) {
+        use_pidfd = 1;
+        close(probe);
+        return;
+    }
+
+    if (pipe2(sigchld_pipe, O_CLOEXEC | O_NONBLOCK) < 0) {
+        perror("pipe failed");
+        return;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = SIGCHLD_TOKEN };
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sigchld_pipe[0], &ev);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigchld_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, NULL);
+}
+
+// Readable whenever a child has changed state since the last reap
+int jobs_event_fd() {
+    return epoll_fd;
+}
+
+void jobs_watch_zygote(int fd) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = ZYGOTE_TOKEN };
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+// A forked copy of the shell that goes on running shell code (a subshell,
+// a built-in stage) gets its own event loop: an epoll set inherited over
+// fork() is shared with the parent, and so would be the zygote's socket
+void jobs_forked_child() {
+    if (epoll_fd >= 0) close(epoll_fd);
+    if (sigchld_pipe[0] >= 0) {
+        close(sigchld_pipe[0]);
+        close(sigchld_pipe[1]);
+        sigchld_pipe[0] = sigchld_pipe[1] = -1;
+    }
+    zygote_forget();
+    jobs_init();
+}
+
+// Starts watching one child; without a pidfd the SIGCHLD pipe covers it
+static void watch_child(job_proc_t* proc) {
+    proc->pidfd = -1;
+    if (!use_pidfd || proc->remote) return;
+
+    proc->pidfd = open_pidfd(proc->pid);
+    if (proc->pidfd < 0) return;
+    fcntl(proc->pidfd, F_SETFD, FD_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = (uint64_t)proc->pid };
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, proc->pidfd, &ev);
+}
+
+static double elapsed_seconds(const struct timespec* start, const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// ============ PID INDEX ============
+
+static unsigned int pid_hash(pid_t pid) {
+    return (unsigned int)pid * 2654435761u;
+}
+
+static void pid_index_put(pid_t pid, int slot);
+
+static void pid_index_rebuild(int capacity) {
+    pid_index_t* old = pid_index;
+    int old_capacity = pid_index_capacity;
+
+    pid_index = (pid_index_t*)calloc(capacity, sizeof(pid_index_t));
+    if (pid_index == NULL) { perror("calloc failed"); exit(1); }
+    pid_index_capacity = capacity;
+    pid_index_used = 0;
+
+    for (int i = 0; i < old_capacity; i++) {
+        if (old[i].pid > 0) pid_index_put(old[i].pid, old[i].slot);
+    }
+    free(old);
+}
+
+static void pid_index_put(pid_t pid, int slot) {
+    if ((pid_index_used + 1) * 2 > pid_index_capacity) {
+        // Size for the live entries only; deleted ones are dropped here
+        int live = 0;
+        for (int i = 0; i < pid_index_capacity; i++) {
+            if (pid_index[i].pid > 0) live++;
+        }
+        int capacity = 64;
+        while (capacity < (live + 1) * 4) capacity *= 2;
+        pid_index_rebuild(capacity);
+    }
+    int mask = pid_index_capacity - 1;
+    int i = pid_hash(pid) & mask;
+    while (pid_index[i].pid > 0) i = (i + 1) & mask;
+    if (pid_index[i].pid == 0) pid_index_used++;
+    pid_index[i].pid = pid;
+    pid_index[i].slot = slot;
+}
+
+static pid_index_t* pid_index_find(pid_t pid) {
+    if (pid_index_capacity == 0) return NULL;
+    int mask = pid_index_capacity - 1;
+    int i = pid_hash(pid) & mask;
+    while (pid_index[i].pid != 0) {
+        if (pid_index[i].pid == pid) return &pid_index[i];
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+// ============ SLOT TABLE ============
+
+static int job_child_exited(pid_t pid, int status, const struct rusage* ru);
+
+static int alloc_slot() {
+    if (job_free_head == -1) {
+        int new_capacity = job_capacity ? job_capacity * 2 : 16;
+        job_t* bigger = (job_t*)realloc(job_slots, sizeof(job_t) * new_capacity);
+        if (bigger == NULL) return -1;
+        job_slots = bigger;
+        // Chain the new slots so the lowest number is handed out first
+        for (int i = new_capacity - 1; i >= job_capacity; i--) {
+            job_slots[i].in_use = 0;
+            job_slots[i].next_free = job_free_head;
+            job_free_head = i;
+        }
+        job_capacity = new_capacity;
+    }
+    int slot = job_free_head;
+    job_free_head = job_slots[slot].next_free;
+    return slot;
+}
+
+static void free_slot(int slot) {
+    job_t* job = &job_slots[slot];
+    for (int i = 0; i < job->nprocs; i++) {
+        pid_index_t* entry = pid_index_find(job->procs[i].pid);
+        if (entry != NULL) entry->pid = -1;
+        if (job->procs[i].pidfd >= 0) close(job->procs[i].pidfd);
+        free(job->procs[i].name);
+        free(job->procs[i].place);
+    }
+    free(job->procs);
+    free(job->cmd);
+    job->in_use = 0;
+    job->next_free = job_free_head;
+    job_free_head = slot;
+}
+
+// Joins the stages back into "cmd args | cmd args" for display
+static char* describe_pipeline(stage_t* stages, int nstages) {
+    size_t len = 1;
+    for (int s = 0; s < nstages; s++) {
+        for (int i = 0; stages[s].argv[i] != NULL; i++) len += strlen(stages[s].argv[i]) + 1;
+        len += 3;
+    }
+    char* text = (char*)malloc(len);
+    if (text == NULL) return NULL;
+
+    char* p = text;
+    for (int s = 0; s < nstages; s++) {
+        if (s > 0) p = stpcpy(p, " | ");
+        for (int i = 0; stages[s].argv[i] != NULL; i++) {
+            if (i > 0) *p++ = ' ';
+            p = stpcpy(p, stages[s].argv[i]);
+        }
+    }
+    *p = '\0';
+    return text;
+}
+
+// Registers a pipeline (foreground or background) and starts watching its
+// children; returns the job number or -1. A stage that could not be
+// started keeps its place with the status spawn_stage() gave it.
+int jobs_add(stage_t* stages, pid_t* pids, int nstages, int foreground) {
+    int slot = alloc_slot();
+    if (slot < 0) { perror("jobs: out of memory"); return -1; }
+
+    job_t* job = &job_slots[slot];
+    job->in_use = 1;
+    job->cmd = foreground ? NULL : describe_pipeline(stages, nstages);
+    job->procs = (job_proc_t*)calloc(nstages, sizeof(job_proc_t));
+    job->nprocs = nstages;
+    job->running = 0;
+    job->status = 0;
+    job->done = 0;
+    job->foreground = foreground;
+    job->collected = 0;
+    memset(&job->usage, 0, sizeof(job->usage));
+    clock_gettime(CLOCK_MONOTONIC, &job->start);
+
+    for (int i = 0; i < nstages; i++) {
+        job_proc_t* proc = &job->procs[i];
+        proc->pid = pids[i] > 0 ? pids[i] : -1;
+        proc->pidfd = -1;
+        proc->remote = stages[i].remote;
+        proc->name = strdup(stages[i].argv[0]);
+        proc->place = stages[i].place ? strdup(stages[i].place->label) : NULL;
+        if (proc->pid < 0) {
+            proc->done = 1;
+            proc->status = stages[i].start_status;
+            continue;
+        }
+        pid_index_put(pids[i], slot);
+        watch_child(proc);
+        job->running++;
+    }
+    job->status = job->procs[nstages - 1].status;
+
+    // A zygote child may have exited before it was registered
+    for (int i = 0; i < nstages; i++) {
+        int status;
+        struct rusage ru;
+        if (job->procs[i].remote && zygote_take_exit(job->procs[i].pid, &status, &ru)) {
+            job_child_exited(job->procs[i].pid, status, &ru);
+        }
+    }
+
+    // Nothing could be started: the job is finished right away
+    if (job->running == 0) {
+        job->done = 1;
+        job->finish_seq = ++finish_counter;
+        job->end = job->start;
+    }
+    return slot + 1;
+}
+
+// Records the exit of one child; returns the job's slot if that finished
+// the job, -1 otherwise
+static int job_child_exited(pid_t pid, int status, const struct rusage* ru) {
+    pid_index_t* entry = pid_index_find(pid);
+    if (entry == NULL) return -1;
+
+    TRACE(TRACE_CHILD, TRACE_END, pid);
+    int slot = entry->slot;
+    job_t* job = &job_slots[slot];
+    entry->pid = -1;
+    rusage_add(&job->usage, ru);
+
+    for (int i = 0; i < job->nprocs; i++) {
+        job_proc_t* proc = &job->procs[i];
+        if (proc->pid != pid) continue;
+
+        proc->done = 1;
+        proc->status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        if (proc->status == 127) path_forget(proc->name);
+        if (proc->pidfd >= 0) {
+            close(proc->pidfd);     // also leaves the epoll set
+            proc->pidfd = -1;
+        }
+        // The job's status is the last stage's, as for foreground pipelines
+        if (i == job->nprocs - 1) job->status = proc->status;
+        break;
+    }
+
+    if (--job->running == 0) {
+        job->done = 1;
+        job->finish_seq = ++finish_counter;
+        clock_gettime(CLOCK_MONOTONIC, &job->end);
+        return slot;
+    }
+    return -1;
+}
+
+// Exit report from the zygote; -1 if pid is not (yet) in the table,
+// otherwise 1 if that finished its job
+int jobs_remote_exit(pid_t pid, int status, const struct rusage* ru) {
+    if (pid_index_find(pid) == NULL) return -1;
+    return job_child_exited(pid, status, ru) >= 0;
+}
+
+// The zygote is gone: every child it still owed a report for ends with
+// the given wait status
+void jobs_fail_remote(int status) {
+    struct rusage none;
+    memset(&none, 0, sizeof(none));
+    for (int slot = 0; slot < job_capacity; slot++) {
+        job_t* job = &job_slots[slot];
+        if (!job->in_use) continue;
+        for (int i = 0; i < job->nprocs; i++) {
+            if (job->procs[i].remote && !job->procs[i].done) {
+                job_child_exited(job->procs[i].pid, status, &none);
+            }
+        }
+    }
+}
+
+// ============ EVENT LOOP ============
+
+// Reaps pid if it has exited; returns 1 if that finished its job
+static int reap_pid(pid_t pid) {
+    int status;
+    struct rusage ru;
+    pid_t got;
+    while ((got = wait4(pid, &status, WNOHANG, &ru)) < 0 && errno == EINTR) {}
+    if (got <= 0) return 0;
+    return job_child_exited(got, status, &ru) >= 0;
+}
+
+// SIGCHLD fallback: collect whichever of the table's children have
+// exited. Not wait4(-1): that would also take a child someone else is
+// blocked on, like a $(...) subshell in subst.c capture_forked()
+static int reap_any() {
+    int finished = 0;
+    for (int i = 0; i < pid_index_capacity; i++) {
+        if (pid_index[i].pid > 0) finished += reap_pid(pid_index[i].pid);
+    }
+    return finished;
+}
+
+// One round of the loop: waits up to timeout_ms (-1 = forever, 0 = poll)
+// for children to exit and handles every ready event. Returns the number
+// of events handled (0 on timeout); *finished counts completed jobs.
+static int dispatch_events(int timeout_ms, int* finished) {
+    struct epoll_event events[EVENT_BATCH];
+    if (epoll_fd < 0) return -1;
+
+    int n = epoll_wait(epoll_fd, events, EVENT_BATCH, timeout_ms);
+    if (n < 0) return errno == EINTR ? 0 : -1;
+
+    for (int i = 0; i < n; i++) {
+        if (events[i].data.u64 == SIGCHLD_TOKEN) {
+            char buf[64];
+            while (read(sigchld_pipe[0], buf, sizeof(buf)) > 0) {
+                // just draining
+            }
+            *finished += reap_any();
+        } else if (events[i].data.u64 == ZYGOTE_TOKEN) {
+            *finished += zygote_dispatch();
+        } else {
+            *finished += reap_pid((pid_t)events[i].data.u64);
+        }
+    }
+    return n;
+}
+
+// Milliseconds left until deadline (-1 stays "forever")
+static int remaining_ms(const struct timespec* deadline, int timeout_ms) {
+    if (timeout_ms < 0) return -1;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long ms = (deadline->tv_sec - now.tv_sec) * 1000 + (deadline->tv_nsec - now.tv_nsec) / 1000000;
+    return ms > 0 ? (int)ms : 0;
+}
+
+static void make_deadline(struct timespec* deadline, int timeout_ms) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    if (timeout_ms < 0) return;
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+static job_t* job_at(int job) {
+    int slot = job - 1;
+    if (slot < 0 || slot >= job_capacity || !job_slots[slot].in_use) return NULL;
+    return &job_slots[slot];
+}
+
+int jobs_is_background(int job) {
+    job_t* j = job_at(job);
+    return j != NULL && !j->foreground;
+}
+
+// Runs the loop until job has finished. Returns 1 when it has, 0 on
+// timeout, -1 if there is no such job
+int jobs_wait_job(int job, int timeout_ms) {
+    job_t* j = job_at(job);
+    if (j == NULL) return -1;
+
+    struct timespec deadline;
+    make_deadline(&deadline, timeout_ms);
+    int finished = 0;
+    int result = 1;
+    TRACE(TRACE_WAIT, TRACE_BEGIN, j->procs[j->nprocs - 1].pid);
+    while (!job_slots[job - 1].done) {
+        int wait_ms = remaining_ms(&deadline, timeout_ms);
+        if (timeout_ms >= 0 && wait_ms == 0) {
+            result = 0;
+            break;
+        }
+        if (dispatch_events(wait_ms, &finished) >= 0) continue;
+
+        // No event loop (jobs_init() not run, or epoll failed): block
+        j = &job_slots[job - 1];
+        for (int i = 0; i < j->nprocs; i++) {
+            if (j->procs[i].done || j->procs[i].remote) continue;
+            int status;
+            struct rusage ru;
+            pid_t pid = j->procs[i].pid;
+            while (wait4(pid, &status, 0, &ru) < 0 && errno == EINTR) {}
+            job_child_exited(pid, status, &ru);
+        }
+        if (!j->done) {
+            result = -1;
+            break;
+        }
+    }
+    TRACE(TRACE_WAIT, TRACE_END, 0);
+    return result;
+}
+
+// Copies the per-stage statuses of a finished job, adds its usage to the
+// running command's accounting, and frees it. Returns the job's status.
+int jobs_collect(int job, int* stage_status) {
+    job_t* j = job_at(job);
+    if (j == NULL) return 127;
+
+    if (stage_status != NULL) {
+        for (int i = 0; i < j->nprocs; i++) stage_status[i] = j->procs[i].status;
+    }
+    usage_add_child(&j->usage);
+    int status = j->status;
+    free_slot(job - 1);
+    return status;
+}
+
+// Finished background job not yet handed out, oldest first
+static int next_finished() {
+    int best = -1;
+    for (int slot = 0; slot < job_capacity; slot++) {
+        job_t* j = &job_slots[slot];
+        if (!j->in_use || !j->done || j->foreground || j->collected) continue;
+        if (best < 0 || j->finish_seq < job_slots[best].finish_seq) best = slot;
+    }
+    return best;
+}
+
+static int background_running() {
+    for (int slot = 0; slot < job_capacity; slot++) {
+        job_t* j = &job_slots[slot];
+        if (j->in_use && !j->foreground && !j->done) return 1;
+    }
+    return 0;
+}
+
+// Waits for the next background job to finish (one that already finished
+// unnoticed counts). Returns its job number and stores its status, 0 on
+// timeout, or -1 when no background job is left. The job stays in the
+// table; the caller releases it or leaves it for the prompt's notice.
+int jobs_wait_any(int timeout_ms, int* status_out) {
+    struct timespec deadline;
+    make_deadline(&deadline, timeout_ms);
+    int finished = 0;
+
+    while (1) {
+        int slot = next_finished();
+        if (slot >= 0) {
+            job_slots[slot].collected = 1;
+            *status_out = job_slots[slot].status;
+            return slot + 1;
+        }
+        if (!background_running()) return -1;
+
+        int wait_ms = remaining_ms(&deadline, timeout_ms);
+        if (timeout_ms >= 0 && wait_ms == 0) return 0;
+        if (dispatch_events(wait_ms, &finished) < 0) return -1;
+    }
+}
+
+// Waits until no background job is running; 1 when done, 0 on timeout
+int jobs_wait_all(int timeout_ms) {
+    struct timespec deadline;
+    make_deadline(&deadline, timeout_ms);
+    int finished = 0;
+
+    while (background_running()) {
+        int wait_ms = remaining_ms(&deadline, timeout_ms);
+        if (timeout_ms >= 0 && wait_ms == 0) return 0;
+        if (dispatch_events(wait_ms, &finished) < 0) return 1;
+    }
+    return 1;
+}
+
+// ============ REAP / REPORT ============
+
+// Handles every pending child event without blocking. Returns the number
+// of background jobs that finished during this call.
+int reap_background_jobs() {
+    int finished = 0;
+    while (dispatch_events(0, &finished) > 0) {
+        // keep going while events are ready
+    }
+    return finished;
+}
+
+// Blocks until one of the given jobs finishes (parallel's runs; other
+// jobs are left alone for the prompt to report) and adds its usage to the
+// running command's accounting. Returns its job number and stores its
+// status, or -1 when none of them can finish any more.
+int jobs_wait_next(const int* jobs, int njobs, int* status_out) {
+    int finished = 0;
+    while (njobs > 0) {
+        for (int i = 0; i < njobs; i++) {
+            job_t* j = job_at(jobs[i]);
+            if (j == NULL || !j->done) continue;
+            usage_add_child(&j->usage);
+            *status_out = j->status;
+            return jobs[i];
+        }
+        if (dispatch_events(-1, &finished) < 0) break;
+    }
+    return -1;
+}
+
+// Drops a finished job without printing a notice (its owner reported it)
+void jobs_release(int job) {
+    int slot = job - 1;
+    if (slot >= 0 && slot < job_capacity && job_slots[slot].in_use) free_slot(slot);
+}
+
+// Frees every finished job's slot, printing a "Done" line for each when
+// print is set (batch mode stays quiet). Returns the number of jobs freed.
+int jobs_notify(int print) {
+    int printed = 0;
+    for (int slot = 0; slot < job_capacity; slot++) {
+        job_t* job = &job_slots[slot];
+        if (!job->in_use || !job->done || job->foreground) continue;
+
+        if (print) {
+            printf("[%d] Done (exit %d, %.2fs) %s\n", slot + 1, job->status,
+                   elapsed_seconds(&job->start, &job->end), job->cmd ? job->cmd : "");
+        }
+        free_slot(slot);
+        printed++;
+    }
+    if (printed) fflush(stdout);
+    return printed;
+}
+
+// jobs built-in: running jobs with their runtime so far, finished ones
+// with exit status and total runtime (which also counts as reporting them).
+// Pipelines list each stage's status as it becomes known.
+void jobs_print() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    for (int slot = 0; slot < job_capacity; slot++) {
+        job_t* job = &job_slots[slot];
+        if (!job->in_use || job->foreground) continue;
+
+        if (job->done) {
+            printf("[%d] Done(%d) %7.2fs", slot + 1, job->status, elapsed_seconds(&job->start, &job->end));
+        } else {
+            printf("[%d] Running %7.2fs", slot + 1, elapsed_seconds(&job->start, &now));
+        }
+        printf(" PID%s:", job->nprocs > 1 ? "s" : "");
+        for (int i = 0; i < job->nprocs; i++) {
+            printf("%s %d", i == 0 ? "" : ",", job->procs[i].pid);
+        }
+        if (job->nprocs > 1) {
+            printf(" STATUS:");
+            for (int i = 0; i < job->nprocs; i++) {
+                if (job->procs[i].done) printf(" %d", job->procs[i].status);
+                else printf(" -");
+            }
+        }
+        if (job->procs[0].place != NULL) {
+            printf(" PLACE:");
+            for (int i = 0; i < job->nprocs; i++) {
+                printf("%s %s", i == 0 ? "" : ",", job->procs[i].place ? job->procs[i].place : "-");
+            }
+        }
+        printf(" CMD: %s\n", job->cmd ? job->cmd : "");
+
+        if (job->done) free_slot(slot);
+    }
+}
+
+void jobs_free() {
+    for (int slot = 0; slot < job_capacity; slot++) {
+        if (job_slots[slot].in_use) free_slot(slot);
+    }
+    free(job_slots);
+    free(pid_index);
+    job_slots = NULL;
+    pid_index = NULL;
+    job_capacity = pid_index_capacity = pid_index_used = 0;
+    job_free_head = -1;
+    if (epoll_fd >= 0) close(epoll_fd);
+    epoll_fd = -1;
+}
@@ -1,32 +1,16 @@
 /* main.c
- * Contains: Main loop, history management, Feature 7 (if-then-else-fi), Feature 8 (variables)
- * Features: 4 (history), 5 (semicolon), 7 (if-then-else-fi), 8 (variables)
- * Calls: shell.c (tokenize, handle_builtin), execute.c (execute)
+ * Contains: Main loop, !n history recall, Feature 7 (if-then-else-fi), Feature 8 (variables)
+ * Features: 4 (history), 5 (command lists: ; && || &), 7 (if-then-else-fi), 8 (variables)
+ * Calls: shell.c (tokenize), execute.c (run_command)
  * Called by: OS entry point
  */
 
 #include "shell.h"
 
-char* history[HISTORY_SIZE];
-int history_count = 0;
-
-job_t jobs_list[MAX_JOBS];
-int jobs_count = 0;
+extern char** environ;
 
 // ============ HISTORY FUNCTIONS (Feature 4) ============
-
-void add_to_history(const char* cmdline) {
-    if (history_count < HISTORY_SIZE) {
-        history[history_count] = strdup(cmdline);
-    } else {
-        free(history[0]);
-        for (int i = 1; i < HISTORY_SIZE; i++) {
-            history[i-1] = history[i];
-        }
-        history[HISTORY_SIZE - 1] = strdup(cmdline);
-    }
-    history_count++;
-}
+// Storage lives in history.c
 
 int handle_bang_command(char** cmdline_ptr) {
     char* cmdline = *cmdline_ptr;
@@ -39,12 +23,13 @@ int handle_bang_command(char** cmdline_ptr) {
             }
             n = n * 10 + (cmdline[i] - '0');
         }
-        if (n < 1 || n > history_count) {
+        char* entry = history_dup(n);
+        if (entry == NULL) {
             fprintf(stderr, "No such command in history: !%d\n", n);
             return 0;
         }
         free(*cmdline_ptr);
-        *cmdline_ptr = strdup(history[n - 1]);
+        *cmdline_ptr = entry;
         printf("%s\n", *cmdline_ptr);
         return 1;
     }
@@ -92,244 +77,489 @@ void trim_string(char* str) {
     }
 }
 
-int read_if_block(if_block_t* block) {
-    char buffer[MAX_LEN];
-    int in_then = 0, in_else = 0;
-    
-    block->then_count = 0;
-    block->else_count = 0;
-    block->condition_cmd = NULL;
-    
-    printf("if> ");
-    fflush(stdout);
-    
-    if (fgets(buffer, sizeof(buffer), stdin) == NULL) {
-        fprintf(stderr, "Error: unexpected EOF in if block\n");
-        return 0;
+// Reads one more line of an if block, trimmed, into cmd_arena.
+// Returns NULL at end of input.
+static char* read_block_line() {
+    // Same source as the main loop, so scripts and -c work too
+    char* line = read_input_line("if> ");
+    if (line == NULL) {
+        return NULL;
     }
+    trim_string(line);
+    char* copy = arena_strdup(&cmd_arena, line);
+    free(line);
+    return copy;
+}
+
+static list_cmd_t* parse_command_list(char* line, int* count);
+static void run_list(list_cmd_t* cmds, int n);
+
+// Turns one body line into a node; its words are tokenized here, once.
+// A line with ; && || or & keeps its command list, tokenized as it runs.
+static cmd_node_t* parse_command_line(char* line) {
+    cmd_node_t* node = (cmd_node_t*)arena_alloc(&cmd_arena, sizeof(cmd_node_t));
+    memset(node, 0, sizeof(cmd_node_t));
     
-    char* cond = buffer;
-    while (*cond == ' ' || *cond == '\t') cond++;
-    if (strncmp(cond, "if", 2) == 0) {
-        cond += 2;
-        while (*cond == ' ' || *cond == '\t') cond++;
+    int n;
+    list_cmd_t* cmds = parse_command_list(line, &n);
+    if (cmds == NULL || n == 0) {
+        node->type = NODE_SIMPLE;       // runs as nothing, like a blank line
+    } else if (n > 1 || cmds[0].join == JOIN_BG) {
+        node->type = NODE_LIST;
+        node->cmds = cmds;
+        node->ncmds = n;
+    } else {
+        node->type = NODE_SIMPLE;
+        node->words = tokenize(cmds[0].text);
     }
+    return node;
+}
+
+// Parses an if-construct whose condition is cond_text (or the next line
+// if cond_text is empty) up to its matching "fi". Nested ifs recurse, and
+// the branches are unbounded linked lists. Everything lives in cmd_arena.
+cmd_node_t* parse_if_block(char* cond_text) {
+    cmd_node_t* node = (cmd_node_t*)arena_alloc(&cmd_arena, sizeof(cmd_node_t));
+    memset(node, 0, sizeof(cmd_node_t));
+    node->type = NODE_IF;
     
-    trim_string(cond);
-    block->condition_cmd = strdup(cond);
+    if (cond_text == NULL || cond_text[0] == '\0') {
+        cond_text = read_block_line();
+        if (cond_text == NULL) {
+            fprintf(stderr, "Error: unexpected EOF in if block\n");
+            return NULL;
+        }
+        if (is_if_statement(cond_text)) {
+            cond_text += strspn(cond_text, " \t") + 2;
+            cond_text += strspn(cond_text, " \t");
+        }
+    }
+    node->cond = tokenize(cond_text);
     
-    in_then = 0;
-    in_else = 0;
+    cmd_node_t** tail = NULL;   // where the next body node gets linked
     
     while (1) {
-        printf("if> ");
-        fflush(stdout);
-        
-        if (fgets(buffer, sizeof(buffer), stdin) == NULL) {
+        char* line = read_block_line();
+        if (line == NULL) {
             fprintf(stderr, "Error: unexpected EOF in if block\n");
-            return 0;
+            return NULL;
         }
         
-        trim_string(buffer);
-        
-        if (is_keyword(buffer, "then")) {
-            in_then = 1;
-            in_else = 0;
+        if (is_keyword(line, "then")) {
+            tail = &node->then_list;
             continue;
-        } else if (is_keyword(buffer, "else")) {
-            in_then = 0;
-            in_else = 1;
+        } else if (is_keyword(line, "else")) {
+            tail = &node->else_list;
             continue;
-        } else if (is_keyword(buffer, "fi")) {
-            return 1;
+        } else if (is_keyword(line, "fi")) {
+            return node;
         }
         
-        if (in_then && block->then_count < MAX_BLOCK_LINES) {
-            block->then_block[block->then_count] = strdup(buffer);
-            block->then_count++;
-        } else if (in_else && block->else_count < MAX_BLOCK_LINES) {
-            block->else_block[block->else_count] = strdup(buffer);
-            block->else_count++;
-        } else if (!in_then && !in_else) {
+        if (line[0] == '\0') continue;
+        if (tail == NULL) {
             fprintf(stderr, "Error: commands must come after 'then' or 'else'\n");
-            return 0;
+            return NULL;
+        }
+        
+        cmd_node_t* child;
+        if (is_if_statement(line)) {
+            char* nested_cond = line + strspn(line, " \t") + 2;
+            child = parse_if_block(nested_cond + strspn(nested_cond, " \t"));
+            if (child == NULL) return NULL;
+        } else {
+            child = parse_command_line(line);
         }
+        *tail = child;
+        tail = &child->next;
     }
-    
-    return 1;
 }
 
-int execute_condition(const char* cmd) {
-    if (cmd == NULL || cmd[0] == '\0') {
+// Runs already-tokenized words: only the expansion pass happens here
+int execute_condition(char** words) {
+    if (words == NULL) {
         return 1;
     }
     
-    char** arglist = tokenize((char*)cmd);
-    if (arglist == NULL) {
+    // true/false and friends are answered in-process; everything else
+    // runs through the normal engine (pipes, redirections, spawn backend)
+    return run_words(words, 0);
+}
+
+void execute_command_list(cmd_node_t* list) {
+    for (cmd_node_t* node = list; node != NULL; node = node->next) {
+        // Each node's expansion is dropped before the next one runs
+        arena_mark_t mark = arena_mark(&cmd_arena);
+        
+        if (node->type == NODE_IF) {
+            last_status = execute_if_node(node);
+        } else if (node->type == NODE_LIST) {
+            run_list(node->cmds, node->ncmds);
+        } else if (node->words != NULL) {
+            run_words(node->words, 0);
+        }
+        
+        arena_release(&cmd_arena, mark);
+    }
+}
+
+int execute_if_node(cmd_node_t* node) {
+    if (node->cond == NULL) {
+        fprintf(stderr, "Error: no condition in if block\n");
         return 1;
     }
     
-    // Feature 8: Expand variables in condition
-    arglist = expand_variables(arglist);
+    // The if's status is that of the last branch command run (0 if none)
+    int cond_status = execute_condition(node->cond);
+    last_status = 0;
+    execute_command_list(cond_status == 0 ? node->then_list : node->else_list);
     
-    int status;
-    int cpid = fork();
+    return last_status;
+}
+
+// cmdline is the "if <condition>" line typed at the prompt
+int handle_if_statement(char* cmdline) {
+    char* cond = cmdline + strspn(cmdline, " \t") + 2;
+    cond += strspn(cond, " \t");
     
-    if (cpid < 0) {
-        perror("fork failed");
+    cmd_node_t* node = parse_if_block(cond);
+    if (node == NULL) {
         return 1;
     }
+    return execute_if_node(node);
+}
+
+// ============ FEATURE 8: ASSIGNMENT ============
+
+// VAR=value: quotes are removed and $(...) runs, but the value is never
+// split into words. Returns the status of the last substitution, or 0.
+int handle_assignment(const char* cmd) {
+    char* equal_pos = strchr(cmd, '=');
+    char* name = arena_strndup(&cmd_arena, cmd, equal_pos - cmd);
     
-    if (cpid == 0) {
-        execvp(arglist[0], arglist);
-        exit(127);
-    } else {
-        waitpid(cpid, &status, 0);
-        
-        for (int i = 0; arglist[i] != NULL; i++)
-            free(arglist[i]);
-        free(arglist);
-        
-        if (WIFEXITED(status)) {
-            return WEXITSTATUS(status);
-        }
-        return 1;
+    last_status = 0;
+    char* value = expand_assignment_value(equal_pos + 1);
+    set_variable(name, value);
+    return last_status;
+}
+
+static char** append_background(char** arglist);
+
+// True if two "name=value" strings are for the same name
+static int same_name(const char* a, const char* b) {
+    while (*a == *b && *a != '=' && *a != '\0') {
+        a++;
+        b++;
     }
+    return *a == '=' && *b == '=';
 }
 
-void execute_block(char** block, int count) {
-    for (int i = 0; i < count; i++) {
-        if (block[i] == NULL || block[i][0] == '\0') continue;
-        
-        char** arglist = tokenize(block[i]);
-        if (arglist != NULL) {
-            // Feature 8: Expand variables before checking builtin
-            arglist = expand_variables(arglist);
-            
-            if (!handle_builtin(arglist)) {
-                execute(arglist);
+static int overridden(const char* entry, char** entries, int n) {
+    for (int i = 0; i < n; i++) {
+        if (same_name(entry, entries[i])) return 1;
+    }
+    return 0;
+}
+
+// The exported entries with these "name=value" entries replacing or added
+// to them, in cmd_arena; the variables themselves are untouched
+static char** overlay_envp(char** entries, int n) {
+    char** base = shell_envp();
+    size_t nbase = 0;
+    while (base[nbase] != NULL) nbase++;
+
+    char** envp = (char**)arena_alloc(&cmd_arena, sizeof(char*) * (nbase + n + 1));
+    size_t count = 0;
+    for (size_t i = 0; i < nbase; i++) {
+        if (!overridden(base[i], entries, n)) envp[count++] = base[i];
+    }
+    // The last assignment to a name wins
+    for (int i = 0; i < n; i++) {
+        if (!overridden(entries[i], entries + i + 1, n - i - 1)) envp[count++] = entries[i];
+    }
+    envp[count] = NULL;
+    return envp;
+}
+
+// Runs tokenized words. NAME=value words on their own set variables; in
+// front of a command they only go into that command's environment (an
+// envp overlay, variables.c). The rest is expanded and run.
+int run_words(char** words, int background) {
+    int nassign = 0;
+    while (is_assignment_word(words[nassign])) nassign++;
+
+    if (words[nassign] == NULL) {
+        for (int i = 0; i < nassign; i++) handle_assignment(words[i]);
+        return last_status;
+    }
+
+    // Feature 8: Expand variables before checking builtin
+    char** arglist = expand_variables(words + nassign);
+    if (background) arglist = append_background(arglist);
+    if (nassign == 0) return run_command(arglist);
+
+    char** entries = (char**)arena_alloc(&cmd_arena, sizeof(char*) * nassign);
+    for (int i = 0; i < nassign; i++) {
+        char* equal_pos = strchr(words[i], '=');
+        char* value = expand_assignment_value(equal_pos + 1);
+        size_t name_len = equal_pos - words[i] + 1;
+        entries[i] = (char*)arena_alloc(&cmd_arena, name_len + strlen(value) + 1);
+        memcpy(entries[i], words[i], name_len);
+        strcpy(entries[i] + name_len, value);
+    }
+    set_env_overlay(overlay_envp(entries, nassign));
+    int status = run_command(arglist);
+    clear_env_overlay();
+    return status;
+}
+
+// ============ MAIN LOOP (Features 5 - Command lists) ============
+
+static const char* const join_names[] = { ";", "&&", "||", "&" };
+
+// Trims text[0..end) in place; end is where the operator was
+static char* trim_command(char* text, char* end) {
+    while (*text == ' ' || *text == '\t' || *text == '\n') text++;
+    while (end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n')) end--;
+    *end = '\0';
+    return text;
+}
+
+// One pass over the line: every unquoted ; && || & (outside $(...)) is
+// cut out and ends a command. Nothing is tokenized yet. Returns the list
+// in cmd_arena, or NULL with *count = -1 on a syntax error.
+static list_cmd_t* parse_command_list(char* line, int* count) {
+    int capacity = 8;
+    list_cmd_t* cmds = (list_cmd_t*)arena_alloc(&cmd_arena, sizeof(list_cmd_t) * capacity);
+    int n = 0;
+
+    char* start = line;
+    char quote = '\0';
+    for (char* p = line; ; p++) {
+        join_t join;
+        char* op_end = p + 1;
+
+        if (*p == '\0') {
+            join = JOIN_SEQ;
+        } else if (quote == '\'') {
+            if (*p == '\'') quote = '\0';
+            continue;
+        } else if (*p == '\\' && p[1] != '\0') {
+            p++;
+            continue;
+        } else if (*p == '$' && p[1] == '(') {
+            const char* close = skip_substitution(p);
+            if (close == NULL) {
+                p += strlen(p) - 1;     // tokenize() reports it
+                continue;
             }
-            for (int j = 0; arglist[j] != NULL; j++)
-                free(arglist[j]);
-            free(arglist);
+            p = (char*)close;
+            continue;
+        } else if (quote == '"') {
+            if (*p == '"') quote = '\0';
+            continue;
+        } else if (*p == '\'' || *p == '"') {
+            quote = *p;
+            continue;
+        } else if (*p == ';') {
+            join = JOIN_SEQ;
+        } else if (*p == '&') {
+            join = p[1] == '&' ? JOIN_AND : JOIN_BG;
+            if (join == JOIN_AND) op_end++;
+        } else if (*p == '|' && p[1] == '|') {
+            join = JOIN_OR;
+            op_end++;
+        } else {
+            continue;
         }
+
+        int at_end = (*p == '\0');
+        char* text = trim_command(start, p);
+        if (*text == '\0') {
+            // Empty commands are only allowed around ';' and at the end,
+            // and nothing may be missing after && or ||
+            int after_and_or = n > 0 && (cmds[n - 1].join == JOIN_AND || cmds[n - 1].join == JOIN_OR);
+            if ((!at_end && join != JOIN_SEQ) || after_and_or) {
+                fprintf(stderr, "Error: syntax error near '%s'\n",
+                        after_and_or ? join_names[cmds[n - 1].join] : join_names[join]);
+                *count = -1;
+                return NULL;
+            }
+        } else {
+            if (n == capacity) {
+                list_cmd_t* bigger = (list_cmd_t*)arena_alloc(&cmd_arena, sizeof(list_cmd_t) * capacity * 2);
+                memcpy(bigger, cmds, sizeof(list_cmd_t) * n);
+                cmds = bigger;
+                capacity *= 2;
+            }
+            cmds[n].text = text;
+            cmds[n].join = join;
+            n++;
+        }
+        if (at_end) break;
+        start = op_end;
+        p = op_end - 1;
     }
+
+    *count = n;
+    return cmds;
 }
 
-int execute_if_block(if_block_t* block) {
-    if (block->condition_cmd == NULL) {
-        fprintf(stderr, "Error: no condition in if block\n");
-        return 1;
+// Appends the '&' operator token that parse_command_list() cut off
+static char** append_background(char** arglist) {
+    int n = 0;
+    while (arglist[n] != NULL) n++;
+    char** words = (char**)arena_alloc(&cmd_arena, sizeof(char*) * (n + 2));
+    memcpy(words, arglist, sizeof(char*) * n);
+    words[n] = OP_BG;
+    words[n + 1] = NULL;
+    return words;
+}
+
+// Runs one command of a list: an if-block, assignments or a pipeline
+static void run_list_command(char* text, int background) {
+    char** words;
+
+    // Feature 7: Check if this is an if statement
+    if (is_if_statement(text)) {
+        last_status = handle_if_statement(text);
+    } else if ((words = tokenize(text)) != NULL) {
+        run_words(words, background);
     }
-    
-    int exit_status = execute_condition(block->condition_cmd);
-    
-    if (exit_status == 0) {
-        execute_block(block->then_block, block->then_count);
-    } else {
-        if (block->else_count > 0) {
-            execute_block(block->else_block, block->else_count);
+}
+
+// The status of each command decides whether the next one runs; a
+// skipped command is never tokenized, expanded or forked
+static void run_list(list_cmd_t* cmds, int n) {
+    int run = 1;
+    for (int i = 0; i < n; i++) {
+        if (run) {
+            // Everything parsed for this command goes away in one step
+            arena_mark_t mark = arena_mark(&cmd_arena);
+            run_list_command(cmds[i].text, cmds[i].join == JOIN_BG);
+            arena_release(&cmd_arena, mark);
         }
+        if (cmds[i].join == JOIN_AND) run = (last_status == 0);
+        else if (cmds[i].join == JOIN_OR) run = (last_status != 0);
+        else run = 1;
     }
-    
-    if (block->condition_cmd) free(block->condition_cmd);
-    for (int i = 0; i < block->then_count; i++) {
-        if (block->then_block[i]) free(block->then_block[i]);
-    }
-    for (int i = 0; i < block->else_count; i++) {
-        if (block->else_block[i]) free(block->else_block[i]);
+}
+
+// Runs a line of commands joined by ; && || and &. Interactive lines
+// also go through !n recall and into the history.
+static void run_segments(char* cmdline, int interactive) {
+    char* line = cmdline;
+    char* recalled = NULL;
+
+    // History and !n recall are for interactive use only
+    if (interactive) {
+        line = trim_command(line, line + strlen(line));
+        if (*line == '\0') return;
+        recalled = strdup(line);
+        handle_bang_command(&recalled);
+        line = recalled;
+        add_to_history(line);
+        add_history(line);
     }
-    
-    return 0;
+
+    arena_mark_t list_mark = arena_mark(&cmd_arena);
+    int n;
+    list_cmd_t* cmds = parse_command_list(line, &n);
+    if (cmds == NULL) last_status = 2;
+    else run_list(cmds, n);
+
+    arena_release(&cmd_arena, list_mark);
+    free(recalled);
 }
 
-int handle_if_statement(char* cmdline) {
-    if_block_t block;
-    
-    if (read_if_block(&block)) {
-        return execute_if_block(&block);
+// Runs one input line
+void run_command_line(char* cmdline) {
+    run_segments(cmdline, input_interactive());
+}
+
+// Runs command text that did not come from the user (the inside of a
+// $(...)), so it never touches the history
+void run_command_string(char* text) {
+    run_segments(text, 0);
+}
+
+static void usage() {
+    fprintf(stderr, "Usage: myshell [-c commands | script [args...]]\n");
+    exit(2);
+}
+
+// The environment the shell started with becomes exported variables, so
+// $HOME works and the children still inherit it
+static void import_environment() {
+    for (char** env = environ; *env != NULL; env++) {
+        if (!is_assignment_word(*env)) continue;
+        const char* equal_sign = strchr(*env, '=');
+        char* name = strndup(*env, equal_sign - *env);
+        if (name == NULL) return;
+        export_variable(name, equal_sign + 1);
+        free(name);
     }
-    
-    return 1;
 }
 
-// ============ MAIN LOOP (Features 5 - Semicolon) ============
+// Script arguments become $0, $1, ...
+static void set_positional_args(int argc, char* argv[]) {
+    char name[16];
+    for (int i = 0; i < argc; i++) {
+        snprintf(name, sizeof(name), "%d", i);
+        set_variable(name, argv[i]);
+    }
+}
 
-int main() {
+int main(int argc, char* argv[]) {
     char* cmdline;
-    char** arglist;
+
+    // Re-executed as the spawn helper (zygote.c)
+    if (argc == 3 && strcmp(argv[1], "--zygote") == 0) return zygote_main(atoi(argv[2]));
+    
+    // Pick the input: -c string, script file, or stdin (readline on a TTY)
+    if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+        if (argc < 3) usage();
+        input_open_string(argv[2]);
+        set_positional_args(argc - 3, argv + 3);
+    } else if (argc > 1 && argv[1][0] == '-') {
+        usage();
+    } else if (argc > 1) {
+        if (input_open_file(argv[1]) != 0) return 127;
+        set_positional_args(argc - 1, argv + 1);
+    } else {
+        input_open_stdin();
+    }
     
-    initialize_readline();
+    int interactive = input_interactive();
+    if (interactive) {
+        initialize_readline();
+        history_init();
+    }
+    jobs_init();
+    import_environment();
+
+    // MYSHELL_SPAWN=zygote starts the helper now, before the shell grows
+    const char* backend = getenv("MYSHELL_SPAWN");
+    if (backend != NULL && set_spawn_mode(backend) == -1) {
+        fprintf(stderr, "myshell: MYSHELL_SPAWN: unknown backend '%s'\n", backend);
+    }
 
-    while ((cmdline = readline(PROMPT)) != NULL) {
+    while (1) {
+        // Report jobs that finished while the last command was running
         reap_background_jobs();
+        jobs_notify(interactive);
         
-        if (*cmdline == '\0') {
-            free(cmdline);
-            continue;
-        }
-
-        char* cmd_ptr = cmdline;
-        char* command;
+        if ((cmdline = read_input_line(PROMPT)) == NULL) break;
         
-        while ((command = strsep(&cmd_ptr, ";")) != NULL) {
-            while (*command == ' ' || *command == '\t') command++;
-            
-            char* end = command + strlen(command) - 1;
-            while (end > command && (*end == ' ' || *end == '\t')) {
-                *end = '\0';
-                end--;
-            }
-            
-            if (*command == '\0') continue;
-
-            char* cmd_copy = strdup(command);
-            handle_bang_command(&cmd_copy);
-            add_to_history(cmd_copy);
-            add_history(cmd_copy);
-
-            // Feature 8: Check for variable assignment
-            if (is_assignment(cmd_copy)) {
-                // Parse assignment
-                char* equal_pos = strchr(cmd_copy, '=');
-                int name_len = equal_pos - cmd_copy;
-                char name[ARGLEN];
-                strncpy(name, cmd_copy, name_len);
-                name[name_len] = '\0';
-                
-                char* value = equal_pos + 1;
-                // Remove quotes if present
-                if ((value[0] == '"' && value[strlen(value)-1] == '"') ||
-                    (value[0] == '\'' && value[strlen(value)-1] == '\'')) {
-                    value++;
-                    char* last = strchr(value, '\0') - 1;
-                    *last = '\0';
-                }
-                
-                set_variable(name, value);
-            }
-            // Feature 7: Check if this is an if statement
-            else if (is_if_statement(cmd_copy)) {
-                handle_if_statement(cmd_copy);
-            } else if ((arglist = tokenize(cmd_copy)) != NULL) {
-                // Feature 8: Expand variables in command
-                arglist = expand_variables(arglist);
-                
-                if (!handle_builtin(arglist)) {
-                    execute(arglist);
-                }
-                for (int i = 0; arglist[i] != NULL; i++)
-                    free(arglist[i]);
-                free(arglist);
-            }
-            
-            free(cmd_copy);
+        if (*cmdline != '\0') {
+            int traced = trace_enabled;
+            if (traced) trace_command(cmdline);
+            run_command_line(cmdline);
+            if (traced) trace_record(TRACE_COMMAND, TRACE_END, 0);
         }
-        
         free(cmdline);
     }
 
-    free_all_variables();
-    printf("\nShell exited.\n");
-    return 0;
+    shell_cleanup();
+    if (interactive) printf("\nShell exited.\n");
+    return last_status;
 }
@@ -0,0 +1,191 @@
+/* parallel.c
+ * Contains: "parallel" built-in - fan one command out over many inputs
+ * Usage: parallel [-j N] command [args...] [::: input...]
+ *   Runs command once per input (from the ::: list, or one per line of
+ *   stdin), with at most N children alive at a time (default: online CPUs).
+ *   Without a ::: list stdin must not be the script the shell is running.
+ *   "{}" in the command is replaced by the input; without it the input is
+ *   appended as the last argument. Exit status is the number of failed
+ *   runs (capped at 101); failures are listed on stderr.
+ * Each run is a regular job (jobs.c), started through spawn_stage() like
+ * any background command and collected with jobs_wait_next(), which
+ * only waits for the runs this call started.
+ * Called by: builtins.c dispatch table
+ */
+
+#include "shell.h"
+
+#define PARALLEL_MAX_STATUS 101
+
+// Next input from the ::: list, or the next stdin line (malloc'd in both
+// cases); NULL when inputs run out
+static char* next_input(char*** list, int from_stdin) {
+    if (!from_stdin) {
+        if (**list == NULL) return NULL;
+        return strdup(*(*list)++);
+    }
+
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t len = getline(&line, &capacity, stdin);
+    if (len < 0) {
+        free(line);
+        return NULL;
+    }
+    if (len > 0 && line[len - 1] == '\n') line[len - 1] = '\0';
+    return line;
+}
+
+// Replaces every "{}" in word with input (arena allocated)
+static char* substitute(const char* word, const char* input) {
+    size_t input_len = strlen(input);
+    size_t count = 0;
+    for (const char* p = strstr(word, "{}"); p != NULL; p = strstr(p + 2, "{}")) count++;
+
+    char* out = (char*)arena_alloc(&cmd_arena, strlen(word) + count * input_len + 1);
+    char* o = out;
+    const char* p = word;
+    const char* hit;
+    while ((hit = strstr(p, "{}")) != NULL) {
+        memcpy(o, p, hit - p);
+        o += hit - p;
+        memcpy(o, input, input_len);
+        o += input_len;
+        p = hit + 2;
+    }
+    strcpy(o, p);
+    return out;
+}
+
+// Builds the argv for one input and starts it as a job; returns the job
+// number, or -1 if the command could not be started at all
+static int start_run(char** command, int ncommand, int has_placeholder, const char* input) {
+    arena_mark_t mark = arena_mark(&cmd_arena);
+
+    char** argv = (char**)arena_alloc(&cmd_arena, sizeof(char*) * (ncommand + 2));
+    int argc = 0;
+    for (int i = 0; i < ncommand; i++) {
+        argv[argc++] = has_placeholder ? substitute(command[i], input) : command[i];
+    }
+    if (!has_placeholder) argv[argc++] = (char*)input;
+    argv[argc] = NULL;
+
+    stage_t stage = { argv, NULL, NULL, 0, NULL };
+    fflush(stdout);
+    pid_t pid = spawn_stage(&stage, -1, -1, -1);
+    int job = -1;
+    if (pid > 0) job = jobs_add(&stage, &pid, 1, 0);
+
+    arena_release(&cmd_arena, mark);
+    return job;
+}
+
+typedef struct {
+    int job;
+    char* input;
+} parallel_run_t;
+
+int builtin_parallel(char** argv) {
+    long max_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int i = 1;
+
+    if (argv[i] != NULL && strcmp(argv[i], "-j") == 0) {
+        if (argv[i + 1] == NULL || atol(argv[i + 1]) < 1) {
+            fprintf(stderr, "parallel: -j needs a positive number\n");
+            return 2;
+        }
+        max_jobs = atol(argv[i + 1]);
+        i += 2;
+    } else if (argv[i] != NULL && strncmp(argv[i], "-j", 2) == 0 && atol(argv[i] + 2) > 0) {
+        max_jobs = atol(argv[i] + 2);
+        i++;
+    }
+    if (max_jobs < 1) max_jobs = 1;
+
+    // Split "command ... ::: inputs ..."
+    char** command = &argv[i];
+    int ncommand = 0;
+    while (command[ncommand] != NULL && strcmp(command[ncommand], ":::") != 0) ncommand++;
+    if (ncommand == 0) {
+        fprintf(stderr, "Usage: parallel [-j N] command [args...] [::: input...]\n");
+        return 2;
+    }
+    int from_stdin = (command[ncommand] == NULL);
+    char** inputs = from_stdin ? NULL : &command[ncommand + 1];
+    if (from_stdin && input_from_stdin()) {
+        fprintf(stderr, "parallel: no ::: inputs, and stdin is the script being run\n");
+        return 2;
+    }
+
+    int has_placeholder = 0;
+    for (int k = 0; k < ncommand; k++) {
+        if (strstr(command[k], "{}") != NULL) has_placeholder = 1;
+    }
+
+    parallel_run_t* runs = (parallel_run_t*)calloc(max_jobs, sizeof(parallel_run_t));
+    int* waiting = (int*)malloc(sizeof(int) * max_jobs);
+    if (runs == NULL || waiting == NULL) {
+        perror("parallel");
+        free(runs);
+        free(waiting);
+        return 2;
+    }
+
+    int running = 0, total = 0, failed = 0;
+    int exhausted = 0;
+
+    while (1) {
+        // Fill every free worker slot
+        while (!exhausted && running < max_jobs) {
+            char* input = next_input(&inputs, from_stdin);
+            if (input == NULL) { exhausted = 1; break; }
+            total++;
+
+            int job = start_run(command, ncommand, has_placeholder, input);
+            if (job < 0) {
+                fprintf(stderr, "parallel: '%s' failed to start\n", input);
+                failed++;
+                free(input);
+                continue;
+            }
+            for (int k = 0; k < max_jobs; k++) {
+                if (runs[k].input == NULL) {
+                    runs[k].job = job;
+                    runs[k].input = input;
+                    break;
+                }
+            }
+            running++;
+        }
+        if (running == 0) break;
+
+        // Collect one finished run; other jobs finishing now are left
+        // in the table for the prompt to report
+        int nwaiting = 0;
+        for (int k = 0; k < max_jobs; k++) {
+            if (runs[k].input != NULL) waiting[nwaiting++] = runs[k].job;
+        }
+        int status;
+        int job = jobs_wait_next(waiting, nwaiting, &status);
+        if (job < 0) break;
+        for (int k = 0; k < max_jobs; k++) {
+            if (runs[k].input == NULL || runs[k].job != job) continue;
+            if (status != 0) {
+                fprintf(stderr, "parallel: exit %d: %s\n", status, runs[k].input);
+                failed++;
+            }
+            jobs_release(job);
+            free(runs[k].input);
+            runs[k].input = NULL;
+            running--;
+            break;
+        }
+    }
+
+    free(runs);
+    free(waiting);
+    if (failed > 0) {
+        fprintf(stderr, "parallel: %d of %d runs failed\n", failed, total);
+    }
+    return failed > PARALLEL_MAX_STATUS ? PARALLEL_MAX_STATUS : failed;
+}
@@ -0,0 +1,213 @@
+/* pathglob.c
+ * Contains: Pathname expansion ("*", "?", "[...]") for unquoted words
+ * A pattern is matched one '/'-separated component at a time; only the
+ * components that contain wildcards read a directory. Listings come from
+ * a small cache of sorted directory entries, revalidated with one stat()
+ * per use (device, inode and mtime), so a loop globbing the same
+ * directory again and again does not repeat readdir(). Names starting
+ * with '.' are only matched by a pattern that starts with '.'.
+ * A pattern that matches nothing is left as it is.
+ * Called by: shell.c expand_variables()
+ */
+
+#include "shell.h"
+#include <fnmatch.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#define DIR_CACHE_SLOTS 16
+
+typedef struct {
+    char* path;
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    char** names;           // sorted, without "." and ".."
+    int nnames;
+    unsigned long last_used;
+    int pinned;
+} dir_listing_t;
+
+static dir_listing_t dir_cache[DIR_CACHE_SLOTS];
+static unsigned long cache_clock = 0;
+
+int has_glob_chars(const char* word) {
+    return strpbrk(word, "*?[") != NULL;
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static void drop_listing(dir_listing_t* d) {
+    for (int i = 0; i < d->nnames; i++) free(d->names[i]);
+    free(d->names);
+    free(d->path);
+    memset(d, 0, sizeof(*d));
+}
+
+static int read_listing(dir_listing_t* d, const char* path, const struct stat* sb) {
+    DIR* dir = opendir(path);
+    if (dir == NULL) return -1;
+
+    int capacity = 64;
+    d->names = (char**)malloc(sizeof(char*) * capacity);
+    d->nnames = 0;
+    struct dirent* entry;
+    while (d->names != NULL && (entry = readdir(dir)) != NULL) {
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+        if (d->nnames == capacity) {
+            char** bigger = (char**)realloc(d->names, sizeof(char*) * capacity * 2);
+            if (bigger == NULL) break;
+            d->names = bigger;
+            capacity *= 2;
+        }
+        d->names[d->nnames++] = strdup(name);
+    }
+    closedir(dir);
+    if (d->names == NULL) return -1;
+
+    qsort(d->names, d->nnames, sizeof(char*), compare_names);
+    d->path = strdup(path);
+    d->dev = sb->st_dev;
+    d->ino = sb->st_ino;
+    d->mtime = sb->st_mtim;
+    return 0;
+}
+
+// Returns the sorted listing of path, from the cache when the directory
+// is unchanged; NULL if it cannot be read. Listings in use further up a
+// recursive match are pinned and never evicted.
+static dir_listing_t* get_listing(const char* path) {
+    struct stat sb;
+    if (stat(path, &sb) < 0 || !S_ISDIR(sb.st_mode)) return NULL;
+
+    dir_listing_t* victim = NULL;
+    for (int i = 0; i < DIR_CACHE_SLOTS; i++) {
+        dir_listing_t* d = &dir_cache[i];
+        if (d->path != NULL && strcmp(d->path, path) == 0
+            && d->dev == sb.st_dev && d->ino == sb.st_ino
+            && d->mtime.tv_sec == sb.st_mtim.tv_sec
+            && d->mtime.tv_nsec == sb.st_mtim.tv_nsec) {
+            d->last_used = ++cache_clock;
+            return d;
+        }
+        if (d->pinned) continue;
+        if (d->path != NULL && strcmp(d->path, path) == 0) {
+            victim = d;     // stale copy: reread into the same slot
+            break;
+        }
+        if (victim == NULL || d->last_used < victim->last_used) victim = d;
+    }
+    if (victim == NULL) return NULL;
+
+    drop_listing(victim);
+    if (read_listing(victim, path, &sb) < 0) {
+        drop_listing(victim);
+        return NULL;
+    }
+    victim->last_used = ++cache_clock;
+    return victim;
+}
+
+// ============ MATCHING ============
+
+typedef struct {
+    char*** list;
+    int* count;
+    int* capacity;
+    int matched;
+} glob_out_t;
+
+static void push_word(glob_out_t* out, const char* path) {
+    if (*out->count + 1 >= *out->capacity) {
+        char** bigger = (char**)arena_alloc(&cmd_arena, sizeof(char*) * (*out->capacity) * 2);
+        memcpy(bigger, *out->list, sizeof(char*) * (*out->count));
+        *out->list = bigger;
+        *out->capacity *= 2;
+    }
+    (*out->list)[(*out->count)++] = arena_strdup(&cmd_arena, path);
+    out->matched++;
+}
+
+// path[0..len) is the directory matched so far ("" or ending in '/');
+// rest is the pattern still to match below it
+static void match_below(char* path, size_t len, const char* rest, glob_out_t* out) {
+    const char* slash = strchr(rest, '/');
+    size_t comp_len = slash ? (size_t)(slash - rest) : strlen(rest);
+
+    // "a//b" and a trailing '/': the slash belongs to the path
+    if (comp_len == 0) {
+        if (len + 1 >= PATH_MAX) return;
+        path[len] = '/';
+        path[len + 1] = '\0';
+        if (slash == NULL || slash[1] == '\0') {
+            struct stat sb;
+            if (stat(path, &sb) == 0 && S_ISDIR(sb.st_mode)) push_word(out, path);
+            return;
+        }
+        match_below(path, len + 1, slash + 1, out);
+        return;
+    }
+
+    char* comp = arena_strndup(&cmd_arena, rest, comp_len);
+
+    if (!has_glob_chars(comp)) {
+        if (len + comp_len + 1 >= PATH_MAX) return;
+        memcpy(path + len, comp, comp_len + 1);
+        if (slash != NULL) {
+            match_below(path, len + comp_len, slash, out);
+        } else {
+            struct stat sb;
+            if (lstat(path, &sb) == 0) push_word(out, path);
+        }
+        return;
+    }
+
+    path[len] = '\0';
+    dir_listing_t* listing = get_listing(len == 0 ? "." : path);
+    if (listing == NULL) return;
+
+    listing->pinned++;
+    for (int i = 0; i < listing->nnames; i++) {
+        const char* name = listing->names[i];
+        if (fnmatch(comp, name, FNM_PERIOD) != 0) continue;
+        size_t name_len = strlen(name);
+        if (len + name_len + 2 >= PATH_MAX) continue;
+        memcpy(path + len, name, name_len + 1);
+
+        if (slash == NULL) {
+            push_word(out, path);
+        } else {
+            match_below(path, len + name_len, slash, out);
+        }
+    }
+    listing->pinned--;
+}
+
+// Appends the matches of pattern to *list (an arena vector with *count
+// entries and room for *capacity), or the pattern itself if nothing
+// matches. The vector is regrown in cmd_arena as needed.
+void glob_word(const char* pattern, char*** list, int* count, int* capacity) {
+    glob_out_t out = { list, count, capacity, 0 };
+    char path[PATH_MAX];
+    size_t len = 0;
+    const char* rest = pattern;
+
+    if (pattern[0] == '/') {
+        path[0] = '/';
+        path[1] = '\0';
+        len = 1;
+        while (*rest == '/') rest++;
+    }
+    match_below(path, len, rest, &out);
+
+    if (out.matched == 0) push_word(&out, pattern);
+}
+
+void glob_cache_free() {
+    for (int i = 0; i < DIR_CACHE_SLOTS; i++) {
+        if (dir_cache[i].path != NULL) drop_listing(&dir_cache[i]);
+    }
+}
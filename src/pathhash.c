@@ -0,0 +1,159 @@
+/* pathhash.c
+ * Contains: Command-location cache ("hash" built-in)
+ * Maps a command name to the absolute path found on PATH so repeated
+ * commands exec directly instead of retrying every PATH directory.
+ * Invalidation: whole table when PATH changes, single entry when the
+ *               cached file turns out to be gone (ENOENT / status 127)
+ * Called by: spawn.c spawn_stage(), shell.c handle_builtin()
+ */
+
+#include "shell.h"
+#include <sys/stat.h>
+
+#define PATH_HASH_BUCKETS 256
+#define DEFAULT_PATH "/bin:/usr/bin"
+
+typedef struct path_entry {
+    char* name;
+    char* path;
+    int hits;
+    struct path_entry* next;
+} path_entry_t;
+
+static path_entry_t* path_buckets[PATH_HASH_BUCKETS];
+static int path_entries = 0;
+static char* cached_path_env = NULL;    // PATH the table was built against
+
+static unsigned int hash_name(const char* name) {
+    return fnv1a(name) % PATH_HASH_BUCKETS;
+}
+
+void path_cache_clear() {
+    for (int i = 0; i < PATH_HASH_BUCKETS; i++) {
+        path_entry_t* e = path_buckets[i];
+        while (e != NULL) {
+            path_entry_t* next = e->next;
+            free(e->name);
+            free(e->path);
+            free(e);
+            e = next;
+        }
+        path_buckets[i] = NULL;
+    }
+    path_entries = 0;
+}
+
+// The search path commands are looked up on: the shell's PATH variable
+const char* shell_path() {
+    var_node_t* path_var = find_variable("PATH");
+    return path_var != NULL ? path_var->value : DEFAULT_PATH;
+}
+
+// Drops the whole table if PATH differs from the one it was built for
+static const char* check_path_env() {
+    const char* path_env = shell_path();
+
+    if (cached_path_env == NULL || strcmp(cached_path_env, path_env) != 0) {
+        path_cache_clear();
+        free(cached_path_env);
+        cached_path_env = strdup(path_env);
+    }
+    return path_env;
+}
+
+// Walks PATH once; returns a malloc'd absolute path or NULL
+static char* search_path(const char* name, const char* path_env) {
+    size_t name_len = strlen(name);
+    const char* dir = path_env;
+
+    while (1) {
+        const char* colon = strchr(dir, ':');
+        size_t dir_len = colon ? (size_t)(colon - dir) : strlen(dir);
+
+        // An empty PATH element means the current directory
+        char* candidate = (char*)malloc(dir_len + name_len + 3);
+        if (candidate == NULL) return NULL;
+        if (dir_len == 0) {
+            strcpy(candidate, ".");
+        } else {
+            memcpy(candidate, dir, dir_len);
+            candidate[dir_len] = '\0';
+        }
+        strcat(candidate, "/");
+        strcat(candidate, name);
+
+        struct stat sb;
+        if (stat(candidate, &sb) == 0 && S_ISREG(sb.st_mode) && access(candidate, X_OK) == 0) {
+            return candidate;
+        }
+        free(candidate);
+
+        if (colon == NULL) break;
+        dir = colon + 1;
+    }
+    return NULL;
+}
+
+// Returns the path to exec for name: name itself if it contains '/',
+// otherwise the cached (or freshly searched) location. NULL = not found.
+const char* path_lookup(const char* name) {
+    if (name == NULL || name[0] == '\0') return NULL;
+    if (strchr(name, '/') != NULL) return name;
+
+    const char* path_env = check_path_env();
+    unsigned int b = hash_name(name);
+
+    for (path_entry_t* e = path_buckets[b]; e != NULL; e = e->next) {
+        if (strcmp(e->name, name) == 0) {
+            e->hits++;
+            return e->path;
+        }
+    }
+
+    char* found = search_path(name, path_env);
+    if (found == NULL) return NULL;
+
+    path_entry_t* e = (path_entry_t*)malloc(sizeof(path_entry_t));
+    if (e == NULL) { free(found); return NULL; }
+    e->name = strdup(name);
+    e->path = found;
+    e->hits = 1;
+    e->next = path_buckets[b];
+    path_buckets[b] = e;
+    path_entries++;
+    return e->path;
+}
+
+// Removes a stale entry so the next lookup searches PATH again
+void path_forget(const char* name) {
+    if (name == NULL || strchr(name, '/') != NULL) return;
+
+    path_entry_t** link = &path_buckets[hash_name(name)];
+    while (*link != NULL) {
+        path_entry_t* e = *link;
+        if (strcmp(e->name, name) == 0) {
+            *link = e->next;
+            free(e->name);
+            free(e->path);
+            free(e);
+            path_entries--;
+            return;
+        }
+        link = &e->next;
+    }
+}
+
+void path_cache_print() {
+    check_path_env();
+    if (path_entries == 0) {
+        printf("hash: hash table empty\n");
+        return;
+    }
+
+    printf("hits\tcommand\n");
+    for (int i = 0; i < PATH_HASH_BUCKETS; i++) {
+        for (path_entry_t* e = path_buckets[i]; e != NULL; e = e->next) {
+            printf("%4d\t%s\n", e->hits, e->path);
+        }
+    }
+}
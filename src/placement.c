@@ -0,0 +1,228 @@
+/* placement.c
+ * Contains: CPU placement of background jobs and pipeline stages
+ * With a policy set, execute() gives every stage of a background job a
+ * CPU set before it starts (foreground commands stay where the scheduler
+ * puts them). The fork and zygote backends pin the child to it with
+ * sched_setaffinity() before exec, the posix backend as soon as
+ * posix_spawn() has returned its pid:
+ *   place rr          - round-robin: each stage gets the next CPU the
+ *                       shell may run on, so concurrent stages never share
+ *   place mask LIST   - every stage gets the same fixed set ("0-3,8")
+ *   place numa        - each job gets the CPUs of the next NUMA node; its
+ *                       stages stay together, next to their pipes
+ *   place off         - the scheduler decides (the default)
+ *   place             - show the policy and its CPU sets
+ * CPU sets are built once, when the policy is chosen, from the shell's
+ * own affinity mask (and /sys/devices/system/node for numa).
+ * Called by: execute.c execute(), spawn.c, zygote.c, builtins.c
+ */
+
+#include "shell.h"
+
+#define NODE_DIR "/sys/devices/system/node"
+
+enum { PLACE_OFF, PLACE_RR, PLACE_MASK, PLACE_NUMA };
+
+static const char* const policy_names[] = { "off", "rr", "mask", "numa" };
+
+static int policy = PLACE_OFF;
+static placement_t* targets = NULL;     // the CPU sets handed out in turn
+static int ntargets = 0;
+static int next_target = 0;
+
+// Parses a kernel-style CPU list ("0-3,8,10-11") into set
+static int parse_cpu_list(const char* text, cpu_set_t* set) {
+    CPU_ZERO(set);
+    const char* p = text;
+    while (*p != '\0' && *p != '\n') {
+        char* end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p || first < 0) return -1;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) return -1;
+        }
+        if (last >= CPU_SETSIZE) return -1;
+        for (long cpu = first; cpu <= last; cpu++) CPU_SET(cpu, set);
+
+        p = end;
+        if (*p == ',') p++;
+        else if (*p != '\0' && *p != '\n') return -1;
+    }
+    return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+static placement_t* add_target(placement_t** list, int* n, const cpu_set_t* cpus, const char* label) {
+    placement_t* bigger = (placement_t*)realloc(*list, sizeof(placement_t) * (*n + 1));
+    if (bigger == NULL) return NULL;
+    *list = bigger;
+    placement_t* target = &bigger[(*n)++];
+    target->cpus = *cpus;
+    snprintf(target->label, sizeof(target->label), "%s", label);
+    return target;
+}
+
+// One target per CPU in the shell's affinity mask
+static int build_rr(const cpu_set_t* allowed, placement_t** list, int* n) {
+    char label[16];
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, allowed)) continue;
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        snprintf(label, sizeof(label), "cpu%d", cpu);
+        if (add_target(list, n, &one, label) == NULL) return -1;
+    }
+    return 0;
+}
+
+// One target per online node that has CPUs the shell may use. Without
+// node information the machine is one node.
+static int build_numa(const cpu_set_t* allowed, placement_t** list, int* n) {
+    char path[64], text[1024], label[16];
+    cpu_set_t nodes;
+
+    FILE* f = fopen(NODE_DIR "/online", "r");
+    int have_nodes = f != NULL && fgets(text, sizeof(text), f) != NULL && parse_cpu_list(text, &nodes) == 0;
+    if (f != NULL) fclose(f);
+
+    for (int node = 0; have_nodes && node < CPU_SETSIZE; node++) {
+        if (!CPU_ISSET(node, &nodes)) continue;
+        snprintf(path, sizeof(path), NODE_DIR "/node%d/cpulist", node);
+        if ((f = fopen(path, "r")) == NULL) continue;
+
+        cpu_set_t cpus;
+        int ok = fgets(text, sizeof(text), f) != NULL && parse_cpu_list(text, &cpus) == 0;
+        fclose(f);
+        if (!ok) continue;      // memory-only node
+
+        CPU_AND(&cpus, &cpus, allowed);
+        if (CPU_COUNT(&cpus) == 0) continue;
+        snprintf(label, sizeof(label), "node%d", node);
+        if (add_target(list, n, &cpus, label) == NULL) return -1;
+    }
+
+    if (*n == 0 && add_target(list, n, allowed, "node0") == NULL) return -1;
+    return 0;
+}
+
+static int set_policy(int new_policy, const char* mask_text) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+        perror("place: sched_getaffinity");
+        return 1;
+    }
+
+    placement_t* list = NULL;
+    int n = 0;
+    int err = 0;
+    if (new_policy == PLACE_RR) {
+        err = build_rr(&allowed, &list, &n);
+    } else if (new_policy == PLACE_NUMA) {
+        err = build_numa(&allowed, &list, &n);
+    } else if (new_policy == PLACE_MASK) {
+        cpu_set_t mask;
+        if (parse_cpu_list(mask_text, &mask) < 0) {
+            fprintf(stderr, "place: invalid CPU list '%s'\n", mask_text);
+            return 1;
+        }
+        CPU_AND(&mask, &mask, &allowed);
+        if (CPU_COUNT(&mask) == 0) {
+            fprintf(stderr, "place: no CPU in '%s' is available\n", mask_text);
+            return 1;
+        }
+        err = add_target(&list, &n, &mask, mask_text) == NULL ? -1 : 0;
+    }
+    if (err < 0) {
+        perror("place: out of memory");
+        free(list);
+        return 1;
+    }
+
+    free(targets);
+    targets = list;
+    ntargets = n;
+    next_target = 0;
+    policy = new_policy;
+    return 0;
+}
+
+// Gives each stage of one job its CPU set (NULL with no policy): rr moves
+// on every stage, numa every job
+void placement_assign(stage_t* stages, int nstages) {
+    if (policy == PLACE_OFF) return;
+
+    const placement_t* job_target = &targets[next_target];
+    if (policy == PLACE_NUMA) next_target = (next_target + 1) % ntargets;
+
+    for (int i = 0; i < nstages; i++) {
+        if (policy == PLACE_RR) {
+            stages[i].place = &targets[next_target];
+            next_target = (next_target + 1) % ntargets;
+        } else {
+            stages[i].place = job_target;
+        }
+    }
+}
+
+// Pins pid (0 = the calling process, a forked child before exec) to cpus;
+// does nothing when cpus is NULL
+void placement_apply(pid_t pid, const cpu_set_t* cpus) {
+    if (cpus != NULL) sched_setaffinity(pid, sizeof(cpu_set_t), cpus);
+}
+
+// ============ BUILT-IN ============
+
+static void print_cpus(const cpu_set_t* cpus) {
+    int first = 1;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, cpus)) continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, cpus)) last++;
+        printf(first ? "%d" : ",%d", cpu);
+        if (last > cpu) printf("-%d", last);
+        first = 0;
+        cpu = last;
+    }
+}
+
+// place [off|rr|numa|mask LIST]
+int builtin_place(char** argv) {
+    if (argv[1] == NULL) {
+        printf("place: %s\n", policy_names[policy]);
+        if (policy == PLACE_RR) {
+            printf("  %d CPUs: ", ntargets);
+            for (int i = 0; i < ntargets; i++) printf(i == 0 ? "%s" : " %s", targets[i].label);
+            printf("\n");
+        } else if (policy != PLACE_OFF) {
+            for (int i = 0; i < ntargets; i++) {
+                printf("  %s: ", targets[i].label);
+                print_cpus(&targets[i].cpus);
+                printf("\n");
+            }
+        }
+        return 0;
+    }
+
+    if (strcmp(argv[1], "off") == 0 && argv[2] == NULL) {
+        placement_free();
+        return 0;
+    }
+    if (strcmp(argv[1], "rr") == 0 && argv[2] == NULL) return set_policy(PLACE_RR, NULL);
+    if (strcmp(argv[1], "numa") == 0 && argv[2] == NULL) return set_policy(PLACE_NUMA, NULL);
+    if (strcmp(argv[1], "mask") == 0 && argv[2] != NULL && argv[3] == NULL) {
+        return set_policy(PLACE_MASK, argv[2]);
+    }
+    fprintf(stderr, "Usage: place [off|rr|numa|mask CPU-LIST]\n");
+    return 2;
+}
+
+void placement_free() {
+    free(targets);
+    targets = NULL;
+    ntargets = 0;
+    next_target = 0;
+    policy = PLACE_OFF;
+}
@@ -1,89 +1,168 @@
 /* shell.c
- * Contains: Utility functions, built-in command handler, Feature 8 (variables)
- * Features: Readline setup, background job reaping, tokenization, built-ins, variables
+ * Contains: Utility functions, Feature 8 (variables)
+ * Features: Readline setup, job notices at the prompt, tokenization, variables
  * Called by: main.c
- * Feature 8 functions: Variable storage, expansion, and display
+ * Feature 8 functions: Assignment detection and expansion (store is in variables.c)
  */
 
 #include "shell.h"
 
-// Feature 8: Global variables linked list head
-var_node_t* variables_head = NULL;
-
 // ============ READLINE FUNCTIONS (Feature 4) ============
 
+// Command names (PATH trie, complete.c) for the first word, file names
+// for everything after it and for anything containing a '/'
 char** my_completion(const char* text, int start, int end) {
     rl_attempted_completion_over = 1;
+    if (strchr(text, '/') == NULL && is_command_position(rl_line_buffer, start)) {
+        return rl_completion_matches(text, command_generator);
+    }
     return rl_completion_matches(text, rl_filename_completion_function);
 }
 
+// Waits for a key while also watching the job table's SIGCHLD pipe, so a
+// finished background job is reported at the prompt right away
+static int shell_getc(FILE* stream) {
+    int in_fd = fileno(stream);
+    int job_fd = jobs_event_fd();
+
+    while (1) {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(in_fd, &fds);
+        if (job_fd != -1) FD_SET(job_fd, &fds);
+        int max_fd = in_fd > job_fd ? in_fd : job_fd;
+
+        if (select(max_fd + 1, &fds, NULL, NULL, NULL) < 0) {
+            if (errno == EINTR) continue;
+            return rl_getc(stream);
+        }
+
+        if (job_fd != -1 && FD_ISSET(job_fd, &fds) && reap_background_jobs() > 0) {
+            // Print below the prompt, then redraw it with the typed text
+            printf("\n");
+            jobs_notify(1);
+            rl_on_new_line();
+            rl_redisplay();
+        }
+        if (FD_ISSET(in_fd, &fds)) {
+            return rl_getc(stream);
+        }
+    }
+}
+
 void initialize_readline() {
     rl_attempted_completion_function = my_completion;
+    rl_getc_function = shell_getc;
     using_history();
 }
 
-// ============ BACKGROUND JOBS (Feature 6) ============
+// ============ TOKENIZE (Feature 1) ============
 
-void reap_background_jobs() {
-    int status;
-    for (int i = 0; i < jobs_count; ) {
-        pid_t ret = waitpid(jobs_list[i].pid, &status, WNOHANG);
-        if (ret > 0) {
-            for (int j = i; j < jobs_count-1; j++)
-                jobs_list[j] = jobs_list[j+1];
-            jobs_count--;
-        } else {
-            i++;
-        }
+// Operator tokens. tokenize() hands out these exact pointers, so callers
+// compare by address and a quoted "|" stays an ordinary word.
+char OP_PIPE[] = "|";
+char OP_IN[] = "<";
+char OP_OUT[] = ">";
+char OP_BG[] = "&";
+
+int is_operator(const char* arg) {
+    return arg == OP_PIPE || arg == OP_IN || arg == OP_OUT || arg == OP_BG;
+}
+
+static char* operator_token(char c) {
+    switch (c) {
+        case '|': return OP_PIPE;
+        case '<': return OP_IN;
+        case '>': return OP_OUT;
+        case '&': return OP_BG;
     }
+    return NULL;
 }
 
-// ============ TOKENIZE (Feature 1) ============
+// Doubles the argument vector; the old one is simply left in the arena
+static char** grow_arglist(char** arglist, int argnum, int* capacity) {
+    char** bigger = (char**)arena_alloc(&cmd_arena, sizeof(char*) * (*capacity) * 2);
+    memcpy(bigger, arglist, sizeof(char*) * argnum);
+    *capacity *= 2;
+    return bigger;
+}
 
-char** tokenize(char* cmdline) {
+// Splits a command line into words and operators with no limit on the
+// number or length of arguments. The line is copied once into cmd_arena
+// and every word is a NUL-terminated view into that copy; quote characters
+// are kept in the word and removed by expand_variables(). The argument
+// vector grows by doubling, so building it stays linear.
+// Returns NULL for an empty line or an unterminated quote.
+static char** split_words(char* cmdline) {
     if (cmdline == NULL || cmdline[0] == '\0' || cmdline[0] == '\n') {
         return NULL;
     }
     
-    char** arglist = (char**)malloc(sizeof(char*) * (MAXARGS + 1));
-    for (int i = 0; i < MAXARGS + 1; i++) {
-        arglist[i] = (char*)malloc(sizeof(char) * ARGLEN);
-        bzero(arglist[i], ARGLEN);
-    }
-    
-    char* cp = cmdline;
-    char* start;
-    int len;
+    char* cp = arena_strdup(&cmd_arena, cmdline);
+    int capacity = 16;
     int argnum = 0;
+    char** arglist = (char**)arena_alloc(&cmd_arena, sizeof(char*) * capacity);
     
-    while (*cp != '\0' && argnum < MAXARGS) {
-        while (*cp == ' ' || *cp == '\t') cp++;
+    while (1) {
+        while (*cp == ' ' || *cp == '\t' || *cp == '\n') cp++;
         if (*cp == '\0') break;
         
-        if (*cp == '<' || *cp == '>' || *cp == '|') {
-            arglist[argnum][0] = *cp;
-            arglist[argnum][1] = '\0';
+        // Keep one slot free for the terminating NULL
+        if (argnum + 1 >= capacity) arglist = grow_arglist(arglist, argnum, &capacity);
+        
+        char* op = operator_token(*cp);
+        if (op != NULL) {
+            arglist[argnum++] = op;
             cp++;
-            argnum++;
             continue;
         }
         
-        start = cp;
-        len = 0;
-        while (*cp != '\0' && *cp != ' ' && *cp != '\t' && *cp != '<' && *cp != '>' && *cp != '|') {
+        // Word: runs to the next unquoted blank or operator
+        char* start = cp;
+        char quote = '\0';
+        while (*cp != '\0') {
+            if (quote != '\'' && *cp == '$' && cp[1] == '(') {
+                // $(...) is one piece of the word, blanks and all
+                const char* close = skip_substitution(cp);
+                if (close == NULL) {
+                    fprintf(stderr, "Error: unterminated $(\n");
+                    return NULL;
+                }
+                cp = (char*)close;
+            } else if (quote) {
+                if (*cp == quote) quote = '\0';
+                else if (*cp == '\\' && quote == '"' && cp[1] != '\0') cp++;
+            } else if (*cp == '\'' || *cp == '"') {
+                quote = *cp;
+            } else if (*cp == '\\' && cp[1] != '\0') {
+                cp++;
+            } else if (*cp == ' ' || *cp == '\t' || *cp == '\n' || operator_token(*cp) != NULL) {
+                break;
+            }
             cp++;
-            len++;
         }
         
-        if (len > ARGLEN - 1) len = ARGLEN - 1;
-        strncpy(arglist[argnum], start, len);
-        arglist[argnum][len] = '\0';
-        argnum++;
+        if (quote) {
+            fprintf(stderr, "Error: unterminated %c quote\n", quote);
+            return NULL;
+        }
+        
+        arglist[argnum++] = start;
+        if (*cp == '\0') break;
+        
+        // Terminate the word in place; an operator glued to it loses its
+        // character to the NUL, so it is emitted here instead
+        char next = *cp;
+        *cp = '\0';
+        op = operator_token(next);
+        if (op != NULL) {
+            if (argnum + 1 >= capacity) arglist = grow_arglist(arglist, argnum, &capacity);
+            arglist[argnum++] = op;
+        }
+        cp++;
     }
     
     if (argnum == 0) {
-        for (int i = 0; i < MAXARGS + 1; i++) free(arglist[i]);
-        free(arglist);
         return NULL;
     }
     
@@ -91,190 +170,75 @@ char** tokenize(char* cmdline) {
     return arglist;
 }
 
-// ============ FEATURE 8: SHELL VARIABLES ============
-
-// Find variable by name
-var_node_t* find_variable(const char* name) {
-    var_node_t* current = variables_head;
-    while (current != NULL) {
-        if (strcmp(current->name, name) == 0) {
-            return current;
-        }
-        current = current->next;
-    }
-    return NULL;
+// split_words() with begin / end records for the trace ring (trace.c)
+char** tokenize(char* cmdline) {
+    TRACE(TRACE_TOKENIZE, TRACE_BEGIN, 0);
+    char** words = split_words(cmdline);
+    TRACE(TRACE_TOKENIZE, TRACE_END, 0);
+    return words;
 }
 
-// Set or create variable
-void set_variable(const char* name, const char* value) {
-    if (name == NULL || value == NULL) return;
-    
-    // Check if variable already exists
-    var_node_t* existing = find_variable(name);
-    if (existing != NULL) {
-        free(existing->value);
-        existing->value = strdup(value);
-        return;
-    }
-    
-    // Create new variable node
-    var_node_t* new_node = (var_node_t*)malloc(sizeof(var_node_t));
-    if (new_node == NULL) return;
-    
-    new_node->name = strdup(name);
-    new_node->value = strdup(value);
-    new_node->next = variables_head;
-    variables_head = new_node;
-}
+// ============ FEATURE 8: SHELL VARIABLES ============
 
-// Print all variables
-void print_all_variables() {
-    var_node_t* current = variables_head;
-    
-    if (current == NULL) {
-        printf("No variables set\n");
-        return;
-    }
+// Check if a word is an assignment: NAME=value, NAME a valid name
+int is_assignment_word(const char* word) {
+    if (word == NULL || !(isalpha((unsigned char)*word) || *word == '_')) return 0;
     
-    printf("Shell Variables:\n");
-    while (current != NULL) {
-        printf("%s=%s\n", current->name, current->value);
-        current = current->next;
-    }
+    const char* p = word + 1;
+    while (isalnum((unsigned char)*p) || *p == '_') p++;
+    return *p == '=';
 }
 
-// Free all variables
-void free_all_variables() {
-    var_node_t* current = variables_head;
-    while (current != NULL) {
-        var_node_t* next = current->next;
-        free(current->name);
-        free(current->value);
-        free(current);
-        current = next;
-    }
-    variables_head = NULL;
+// Makes room for the words still to come (and the NULL) after a word
+// expanded to an unknown number of words
+static void reserve_rest(char*** expanded, int n, int* capacity, int remaining) {
+    if (*capacity - n >= remaining) return;
+    char** bigger = (char**)arena_alloc(&cmd_arena, sizeof(char*) * (n + remaining + 1));
+    memcpy(bigger, *expanded, sizeof(char*) * n);
+    *expanded = bigger;
+    *capacity = n + remaining + 1;
 }
 
-// Check if command is variable assignment
-int is_assignment(const char* cmd) {
-    if (cmd == NULL) return 0;
-    
-    const char* equal_sign = strchr(cmd, '=');
-    if (equal_sign == NULL) return 0;
-    
-    // Check if there are spaces around =
-    if (equal_sign == cmd || equal_sign[1] == '\0') return 0;
-    
-    // Check if name part is valid (no spaces before =)
-    for (const char* p = cmd; p < equal_sign; p++) {
-        if (*p == ' ' || *p == '\t') return 0;
-    }
-    
-    return 1;
-}
-
-// Expand variables in argument list
+// Expands every word with '$', quotes or backslashes in one builder pass
+// (subst.c): $VAR and ${VAR} anywhere in the word, $?, $(...), quote
+// removal. Then pathnames: an unquoted word with * ? or [ becomes the
+// sorted list of matching paths (pathglob.c), so the result can be longer
+// than the input, as can an unquoted $(...); an unquoted word that expands
+// to nothing is dropped. Quoted words, $ results and redirection targets
+// are never globbed.
+// The result lives in cmd_arena; plain words are shared, not copied
 char** expand_variables(char** arglist) {
     if (arglist == NULL) return NULL;
+    TRACE(TRACE_EXPAND, TRACE_BEGIN, 0);
     
     // Count arguments
     int count = 0;
     while (arglist[count] != NULL) count++;
     
     // Create new expanded argument list
-    char** expanded = (char**)malloc(sizeof(char*) * (count + 1));
+    int capacity = count + 1;
+    int n = 0;
+    char** expanded = (char**)arena_alloc(&cmd_arena, sizeof(char*) * capacity);
     
     for (int i = 0; i < count; i++) {
-        if (arglist[i][0] == '$') {
-            // Variable expansion
-            const char* var_name = &arglist[i][1];
-            var_node_t* var = find_variable(var_name);
-            
-            if (var != NULL) {
-                expanded[i] = (char*)malloc(strlen(var->value) + 1);
-                strcpy(expanded[i], var->value);
-            } else {
-                // Variable not found, keep original (empty or $NAME)
-                expanded[i] = (char*)malloc(strlen(arglist[i]) + 1);
-                strcpy(expanded[i], "");
-            }
+        if (is_operator(arglist[i])) {
+            expanded[n++] = arglist[i];
+        } else if (strpbrk(arglist[i], "$'\"\\") != NULL) {
+            // Zero or more words: "" is one, an unset $VAR none
+            expand_word(arglist[i], &expanded, &n, &capacity);
+            reserve_rest(&expanded, n, &capacity, count - i);
+        } else if (has_glob_chars(arglist[i])
+                   && (i == 0 || (arglist[i - 1] != OP_IN && arglist[i - 1] != OP_OUT))) {
+            // Every match takes a slot; the rest of the words still need theirs
+            glob_word(arglist[i], &expanded, &n, &capacity);
+            reserve_rest(&expanded, n, &capacity, count - i);
         } else {
             // No variable expansion needed
-            expanded[i] = (char*)malloc(strlen(arglist[i]) + 1);
-            strcpy(expanded[i], arglist[i]);
+            expanded[n++] = arglist[i];
         }
     }
     
-    expanded[count] = NULL;
-    
-    // Free old arglist
-    for (int i = 0; i < count; i++) {
-        free(arglist[i]);
-    }
-    free(arglist);
-    
+    expanded[n] = NULL;
+    TRACE(TRACE_EXPAND, TRACE_END, 0);
     return expanded;
 }
-
-// ============ BUILT-IN HANDLER (Features 1, 6, 8) ============
-
-int handle_builtin(char **arglist) {
-    if (arglist == NULL || arglist[0] == NULL)
-        return 0;
-    
-    // exit command
-    if (strcmp(arglist[0], "exit") == 0) {
-        printf("Exiting shell...\n");
-        free_all_variables();
-        exit(0);
-    }
-    // cd command
-    else if (strcmp(arglist[0], "cd") == 0) {
-        if (arglist[1] == NULL) {
-            fprintf(stderr, "cd: missing argument\n");
-        } else {
-            if (chdir(arglist[1]) != 0) {
-                perror("cd failed");
-            }
-        }
-        return 1;
-    }
-    // help command
-    // Help command after the issue is resolved
-    else if (strcmp(arglist[0], "help") == 0) {
-        printf("Built-in commands:\n");
-        printf("  cd <dir>            - Change directory\n");
-        printf("  help                - Show this help message\n");
-        printf("  exit                - Exit the shell\n");
-        printf("  jobs                - List background jobs\n");
-        printf("  history             - Show command history\n");
-        printf("  set                 - Show all variables\n");
-        return 1;
-    }
-    // jobs command (Feature 6)
-    else if (strcmp(arglist[0], "jobs") == 0) {
-        reap_background_jobs();
-        
-        for (int i = 0; i < jobs_count; i++) {
-            printf("[%d] PID: %d CMD: %s\n", i + 1, jobs_list[i].pid, jobs_list[i].cmd);
-        }
-        return 1;
-    }
-    // history command (Feature 4)
-    else if (strcmp(arglist[0], "history") == 0) {
-        int count = history_count < HISTORY_SIZE ? history_count : HISTORY_SIZE;
-        
-        for (int i = 0; i < count; i++) {
-            printf("%d %s\n", i + 1, history[i]);
-        }
-        return 1;
-    }
-    // set command (Feature 8)
-    else if (strcmp(arglist[0], "set") == 0) {
-        print_all_variables();
-        return 1;
-    }
-    
-    return 0; // Not a built-in
-}
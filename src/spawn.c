@@ -0,0 +1,272 @@
+/* spawn.c
+ * Contains: Process spawn backends used by the execution engine
+ * Backends: "fork"  - classic fork() + dup2() + execve()
+ *           "posix" - posix_spawn() with file actions (glibc runs it on
+ *                     clone(CLONE_VM|CLONE_VFORK), so no page tables are copied)
+ *           "zygote" - a helper process forks and execs (zygote.c); falls
+ *                     back to posix_spawn when the helper is unavailable
+ * Called by: execute.c launch_pipeline()
+ * Both backends exec the absolute path resolved by pathhash.c, with the
+ * cached envp of exported variables (variables.c shell_envp()), pinned
+ * to the stage's CPU set when a placement policy is on (placement.c)
+ * Selected at runtime with the "spawn" built-in
+ */
+
+#include "shell.h"
+#include <spawn.h>
+
+int spawn_mode = SPAWN_FORK;
+
+static const char* spawn_mode_names[] = { "fork", "posix", "zygote" };
+
+const char* spawn_mode_name(int mode) {
+    if (mode < 0 || mode > SPAWN_ZYGOTE) return "unknown";
+    return spawn_mode_names[mode];
+}
+
+// Returns -1 for an unknown name, -2 if the zygote could not be started
+int set_spawn_mode(const char* name) {
+    for (int i = 0; i <= SPAWN_ZYGOTE; i++) {
+        if (strcmp(name, spawn_mode_names[i]) == 0) {
+            if (i == SPAWN_ZYGOTE && zygote_start() < 0) return -2;
+            spawn_mode = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// ============ FORK BACKEND ============
+
+static pid_t spawn_fork(stage_t* st, const char* path, int in_fd, int out_fd) {
+    pid_t cpid = fork();
+    if (cpid < 0) {
+        perror("fork failed");
+        return -1;
+    }
+    if (cpid > 0) return cpid;
+
+    // Child: pipe ends first, then the stage's own redirections on top.
+    // Pipe fds are O_CLOEXEC, so only the dup2'd copies survive exec.
+    if (in_fd != -1) dup2(in_fd, STDIN_FILENO);
+    if (out_fd != -1) dup2(out_fd, STDOUT_FILENO);
+
+    if (st->input_file) {
+        int fd = open(st->input_file, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Error: cannot open input file '%s': %s\n", st->input_file, strerror(errno));
+            exit(1);
+        }
+        dup2(fd, STDIN_FILENO);
+        close(fd);
+    }
+
+    if (st->output_file) {
+        int fd = open(st->output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "Error: cannot open output file '%s': %s\n", st->output_file, strerror(errno));
+            exit(1);
+        }
+        dup2(fd, STDOUT_FILENO);
+        close(fd);
+    }
+
+    placement_apply(0, st->place ? &st->place->cpus : NULL);
+    execve(path, st->argv, shell_envp());
+    if (errno == ENOENT) {
+        fprintf(stderr, "Error: command not found: %s\n", st->argv[0]);
+        exit(127);
+    }
+    fprintf(stderr, "Error: cannot run '%s': %s\n", st->argv[0], strerror(errno));
+    exit(126);
+}
+
+// ============ POSIX_SPAWN BACKEND ============
+
+// Redirection files are opened here in the parent (close-on-exec) so that
+// open errors keep their usual messages; they replace *in_fd / *out_fd and
+// are returned in file_in / file_out for the caller to close afterwards.
+static int open_stage_files(stage_t* st, int* in_fd, int* out_fd, int* file_in, int* file_out) {
+    *file_in = *file_out = -1;
+
+    if (st->input_file) {
+        *file_in = open(st->input_file, O_RDONLY | O_CLOEXEC);
+        if (*file_in < 0) {
+            fprintf(stderr, "Error: cannot open input file '%s': %s\n", st->input_file, strerror(errno));
+            return -1;
+        }
+        *in_fd = *file_in;
+    }
+
+    if (st->output_file) {
+        *file_out = open(st->output_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (*file_out < 0) {
+            fprintf(stderr, "Error: cannot open output file '%s': %s\n", st->output_file, strerror(errno));
+            if (*file_in != -1) close(*file_in);
+            return -1;
+        }
+        *out_fd = *file_out;
+    }
+    return 0;
+}
+
+static void close_stage_files(int file_in, int file_out) {
+    if (file_in != -1) close(file_in);
+    if (file_out != -1) close(file_out);
+}
+
+// Same messages and statuses as a fork child whose execve() failed
+static void report_spawn_error(stage_t* st, int err) {
+    if (err == ENOENT) fprintf(stderr, "Error: command not found: %s\n", st->argv[0]);
+    else fprintf(stderr, "Error: cannot run '%s': %s\n", st->argv[0], strerror(err));
+    st->start_status = err == ENOENT ? 127 : 126;
+}
+
+// in_fd / out_fd are final here: the child only sees dup2 actions
+static pid_t posix_spawn_fds(stage_t* st, const char* path, int in_fd, int out_fd) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (in_fd != -1) posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO);
+    if (out_fd != -1) posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+
+    pid_t cpid;
+    int err = posix_spawn(&cpid, path, &actions, NULL, st->argv, shell_envp());
+    if (err == ENOENT && path != st->argv[0]) {
+        // Cached location went away: forget it and search PATH once more
+        path_forget(st->argv[0]);
+        path = path_lookup(st->argv[0]);
+        if (path != NULL) {
+            err = posix_spawn(&cpid, path, &actions, NULL, st->argv, shell_envp());
+        }
+    }
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (err != 0) {
+        report_spawn_error(st, err);
+        return -1;
+    }
+    // posix_spawn has no affinity attribute: pin the child from outside
+    placement_apply(cpid, st->place ? &st->place->cpus : NULL);
+    return cpid;
+}
+
+static pid_t spawn_posix(stage_t* st, const char* path, int in_fd, int out_fd) {
+    int file_in, file_out;
+    if (open_stage_files(st, &in_fd, &out_fd, &file_in, &file_out) < 0) return -1;
+    pid_t cpid = posix_spawn_fds(st, path, in_fd, out_fd);
+    close_stage_files(file_in, file_out);
+    return cpid;
+}
+
+// ============ ZYGOTE BACKEND ============
+
+// Same file handling as posix; the fds travel to the helper instead
+static pid_t spawn_zygote(stage_t* st, const char* path, int in_fd, int out_fd) {
+    int file_in, file_out;
+    if (open_stage_files(st, &in_fd, &out_fd, &file_in, &file_out) < 0) return -1;
+
+    int err = 0;
+    const cpu_set_t* cpus = st->place ? &st->place->cpus : NULL;
+    pid_t cpid = zygote_spawn(path, st->argv, in_fd, out_fd, cpus, &err);
+    if (cpid == -1 && err == ENOENT && path != st->argv[0]) {
+        path_forget(st->argv[0]);
+        path = path_lookup(st->argv[0]);
+        if (path != NULL) cpid = zygote_spawn(path, st->argv, in_fd, out_fd, cpus, &err);
+    }
+
+    if (cpid == ZYGOTE_UNAVAILABLE) {
+        cpid = posix_spawn_fds(st, path, in_fd, out_fd);
+    } else if (cpid > 0) {
+        st->remote = 1;
+    } else {
+        report_spawn_error(st, err);
+    }
+    close_stage_files(file_in, file_out);
+    return cpid;
+}
+
+// ============ BUILT-IN STAGES ============
+
+// A built-in in a pipeline or in the background still needs its own
+// process to run concurrently, but no exec: the forked child calls it.
+// Without an exec nothing closes next_fd, the read end of the pipe to the
+// next stage, so the child does; holding it, a built-in writing to a stage
+// that has exited would block on its own pipe instead of getting EPIPE.
+static pid_t spawn_builtin(stage_t* st, const builtin_t* builtin, int in_fd, int out_fd, int next_fd) {
+    pid_t cpid = fork();
+    if (cpid < 0) {
+        perror("fork failed");
+        return -1;
+    }
+    if (cpid > 0) return cpid;
+
+    jobs_forked_child();
+    if (next_fd != -1) close(next_fd);
+    if (in_fd != -1) dup2(in_fd, STDIN_FILENO);
+    if (out_fd != -1) dup2(out_fd, STDOUT_FILENO);
+    if (in_fd != -1) close(in_fd);
+    if (out_fd != -1) close(out_fd);
+
+    if (st->input_file) {
+        int fd = open(st->input_file, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Error: cannot open input file '%s': %s\n", st->input_file, strerror(errno));
+            _exit(1);
+        }
+        dup2(fd, STDIN_FILENO);
+        close(fd);
+    }
+    if (st->output_file) {
+        int fd = open(st->output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "Error: cannot open output file '%s': %s\n", st->output_file, strerror(errno));
+            _exit(1);
+        }
+        dup2(fd, STDOUT_FILENO);
+        close(fd);
+    }
+
+    placement_apply(0, st->place ? &st->place->cpus : NULL);
+    int status = builtin->fn(st->argv);
+    fflush(stdout);
+    _exit(status);
+}
+
+// ============ DISPATCH ============
+
+static pid_t start_stage(stage_t* st, int in_fd, int out_fd, int next_fd) {
+    const builtin_t* builtin = find_builtin(st->argv);
+    if (builtin != NULL) {
+        return spawn_builtin(st, builtin, in_fd, out_fd, next_fd);
+    }
+
+    const char* path = path_lookup(st->argv[0]);
+    if (path == NULL) {
+        fprintf(stderr, "Error: command not found: %s\n", st->argv[0]);
+        st->start_status = 127;
+        return -1;
+    }
+
+    if (spawn_mode == SPAWN_POSIX) {
+        return spawn_posix(st, path, in_fd, out_fd);
+    }
+    if (spawn_mode == SPAWN_ZYGOTE) {
+        return spawn_zygote(st, path, in_fd, out_fd);
+    }
+    return spawn_fork(st, path, in_fd, out_fd);
+}
+
+// Starts one pipeline stage. in_fd/out_fd are pipe ends to install as
+// stdin/stdout (-1 = inherit); next_fd is the shell's read end of out_fd's
+// pipe (-1 = none), which the child must not keep. Returns the child PID,
+// or -1 if the stage could not be started: the error has already been
+// reported and st->start_status holds the status the fork backend's child
+// would have exited with (127 not found, 126 not runnable, 1 otherwise,
+// e.g. a redirection that could not be opened).
+pid_t spawn_stage(stage_t* st, int in_fd, int out_fd, int next_fd) {
+    st->start_status = 1;
+    TRACE(TRACE_SPAWN, TRACE_BEGIN, 0);
+    pid_t cpid = start_stage(st, in_fd, out_fd, next_fd);
+    TRACE(TRACE_SPAWN, TRACE_END, cpid);
+    return cpid;
+}
@@ -0,0 +1,365 @@
+/* subst.c
+ * Contains: Word expansion - the word builder, parameters ($VAR, ${VAR},
+ *           $?, $$, $0-$9) and command substitution "$(...)"
+ * One pass over a word handles quotes, backslashes, parameters and
+ * substitutions, appending to one arena buffer that doubles as needed.
+ * Parameters expand anywhere in a word and inside double quotes; an unset
+ * one is empty, and an unquoted word left with nothing disappears.
+ * Parameter values are never split into words.
+ * The inner command's stdout is captured into a buffer that doubles as it
+ * grows, so large outputs are read in linear time. Trailing newlines are
+ * dropped. Outside double quotes the result is split into words at blanks
+ * and newlines; inside them, and in VAR=value, it stays one word.
+ * A substitution that is a single pure built-in (echo, printf, pwd, ...)
+ * runs in the shell with stdout pointed at a memfd; anything else runs in
+ * a forked copy of the shell, like a subshell.
+ * Called by: shell.c tokenize(), expand_variables(); main.c handle_assignment()
+ *            (words without '$', quotes or backslashes never get here)
+ */
+
+#include "shell.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CAPTURE_INITIAL 4096
+#define NAME_BUFFER 64
+
+// ============ SCANNING ============
+
+// p points at "$(": returns the matching ')' (quotes and nested
+// substitutions inside are skipped), or NULL if it is never closed
+const char* skip_substitution(const char* p) {
+    int depth = 1;
+    char quote = '\0';
+    for (p += 2; *p != '\0'; p++) {
+        if (quote == '\'') {
+            if (*p == '\'') quote = '\0';
+        } else if (*p == '\\' && p[1] != '\0') {
+            p++;
+        } else if (*p == '$' && p[1] == '(') {
+            p = skip_substitution(p);
+            if (p == NULL) return NULL;
+        } else if (quote == '"') {
+            if (*p == '"') quote = '\0';
+        } else if (*p == '\'' || *p == '"') {
+            quote = *p;
+        } else if (*p == '(') {
+            depth++;
+        } else if (*p == ')' && --depth == 0) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// ============ CAPTURE ============
+
+typedef struct {
+    char* data;
+    size_t len;
+    size_t capacity;
+} capture_t;
+
+// Reads fd to EOF, doubling the buffer whenever it fills
+static void read_all(int fd, capture_t* out) {
+    while (1) {
+        if (out->capacity - out->len < CAPTURE_INITIAL / 2) {
+            size_t new_capacity = out->capacity ? out->capacity * 2 : CAPTURE_INITIAL;
+            char* bigger = (char*)realloc(out->data, new_capacity);
+            if (bigger == NULL) return;
+            out->data = bigger;
+            out->capacity = new_capacity;
+        }
+        ssize_t n = read(fd, out->data + out->len, out->capacity - out->len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        out->len += n;
+    }
+}
+
+// A single pure built-in with no pipe, '&', ';', assignment or if can
+// run in the shell. The command word is checked before anything is
+// expanded, so nested substitutions never run twice.
+static char** pure_builtin_argv(const char* text) {
+    if (strchr(text, ';') != NULL || is_if_statement(text)) return NULL;
+
+    char** words = tokenize((char*)text);
+    if (words == NULL || is_assignment_word(words[0]) || strpbrk(words[0], "$'\"\\") != NULL) return NULL;
+    for (int i = 0; words[i] != NULL; i++) {
+        if (words[i] == OP_PIPE || words[i] == OP_BG) return NULL;
+    }
+    const builtin_t* builtin = find_builtin(words);
+    if (builtin == NULL || !builtin->pure) return NULL;
+    return expand_variables(words);
+}
+
+// Runs a pure built-in with stdout on a memfd, then reads the memfd back
+static int capture_builtin(char** argv, capture_t* out) {
+    int mem_fd = memfd_create("myshell-subst", MFD_CLOEXEC);
+    if (mem_fd < 0) return -1;
+
+    fflush(stdout);
+    int saved = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 10);
+    dup2(mem_fd, STDOUT_FILENO);
+
+    handle_builtin(argv);
+
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    lseek(mem_fd, 0, SEEK_SET);
+    read_all(mem_fd, out);
+    close(mem_fd);
+    return 0;
+}
+
+// Runs text in a forked copy of the shell with stdout on a pipe
+static void capture_forked(const char* text, capture_t* out) {
+    int fd[2];
+    if (pipe2(fd, O_CLOEXEC) < 0) {
+        perror("pipe failed");
+        last_status = 1;
+        return;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork failed");
+        close(fd[0]);
+        close(fd[1]);
+        last_status = 1;
+        return;
+    }
+    if (pid == 0) {
+        jobs_forked_child();
+        close(fd[0]);
+        dup2(fd[1], STDOUT_FILENO);
+        run_command_string(strdup(text));
+        fflush(stdout);
+        _exit(last_status);
+    }
+
+    close(fd[1]);
+    read_all(fd[0], out);
+    close(fd[0]);
+
+    int status;
+    struct rusage ru;
+    while (wait4(pid, &status, 0, &ru) < 0) {
+        if (errno != EINTR) {
+            last_status = 1;
+            return;
+        }
+    }
+    usage_add_child(&ru);
+    last_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+// Output of the command in text[0..len), trailing newlines removed
+// (malloc'd; *len_out is set). Sets last_status to the command's status.
+static char* capture_command(const char* text, size_t len, size_t* len_out) {
+    capture_t out = { NULL, 0, 0 };
+    char* inner = arena_strndup(&cmd_arena, text, len);
+
+    arena_mark_t mark = arena_mark(&cmd_arena);
+    char** argv = pure_builtin_argv(inner);
+    if (argv == NULL || capture_builtin(argv, &out) < 0) {
+        capture_forked(inner, &out);
+    }
+    arena_release(&cmd_arena, mark);
+
+    while (out.len > 0 && out.data[out.len - 1] == '\n') out.len--;
+    *len_out = out.len;
+    return out.data;
+}
+
+// ============ WORD BUILDER ============
+
+typedef struct {
+    char* buf;              // current word (arena)
+    size_t len;
+    size_t capacity;
+    int started;            // a word exists even if empty ("" or '')
+    int split;              // split unquoted substitutions into words
+    char*** list;
+    int* count;
+    int* list_capacity;
+    char* single;           // no-split mode: the one result
+} word_builder_t;
+
+static void put_char(word_builder_t* b, char c) {
+    if (b->len + 1 >= b->capacity) {
+        size_t new_capacity = b->capacity ? b->capacity * 2 : 64;
+        char* bigger = (char*)arena_alloc(&cmd_arena, new_capacity);
+        if (b->len) memcpy(bigger, b->buf, b->len);
+        b->buf = bigger;
+        b->capacity = new_capacity;
+    }
+    b->buf[b->len++] = c;
+    b->started = 1;
+}
+
+static void end_word(word_builder_t* b) {
+    if (!b->started) return;
+    put_char(b, '\0');
+    if (b->list == NULL) {
+        b->single = b->buf;
+    } else {
+        if (*b->count + 1 >= *b->list_capacity) {
+            char** bigger = (char**)arena_alloc(&cmd_arena, sizeof(char*) * (*b->list_capacity) * 2);
+            memcpy(bigger, *b->list, sizeof(char*) * (*b->count));
+            *b->list = bigger;
+            *b->list_capacity *= 2;
+        }
+        (*b->list)[(*b->count)++] = b->buf;
+    }
+    b->buf = NULL;
+    b->len = b->capacity = 0;
+    b->started = 0;
+}
+
+static void put_bytes(word_builder_t* b, const char* data, size_t len) {
+    if (len == 0) return;
+    if (b->len + len + 1 > b->capacity) {
+        size_t new_capacity = b->capacity ? b->capacity * 2 : 64;
+        while (new_capacity < b->len + len + 1) new_capacity *= 2;
+        char* bigger = (char*)arena_alloc(&cmd_arena, new_capacity);
+        if (b->len) memcpy(bigger, b->buf, b->len);
+        b->buf = bigger;
+        b->capacity = new_capacity;
+    }
+    memcpy(b->buf + b->len, data, len);
+    b->len += len;
+    b->started = 1;
+}
+
+static void put_output(word_builder_t* b, const char* data, size_t len, int quoted) {
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        if (!quoted && b->split && (c == ' ' || c == '\t' || c == '\n')) {
+            end_word(b);
+        } else {
+            put_char(b, c);
+        }
+    }
+}
+
+// ============ PARAMETERS ============
+
+static int is_name_char(char c, int first) {
+    return c == '_' || isalpha((unsigned char)c) || (!first && isdigit((unsigned char)c));
+}
+
+// True if p (at a '$') starts a parameter; anything else is a literal '$'
+static int starts_parameter(const char* p) {
+    return p[1] == '{' || p[1] == '?' || p[1] == '$'
+           || isdigit((unsigned char)p[1]) || is_name_char(p[1], 1);
+}
+
+// p points at '$': appends the value of $NAME, ${NAME}, $?, $$ or $0-$9
+// and returns the last character it used
+static const char* put_parameter(word_builder_t* b, const char* p, int quoted) {
+    const char* name = p + 1;
+    const char* last;
+    size_t len;
+
+    if (p[1] == '{') {
+        const char* close = strchr(p + 2, '}');
+        if (close == NULL) {
+            put_char(b, '$');       // no closing brace: taken literally
+            return p;
+        }
+        name = p + 2;
+        len = close - name;
+        last = close;
+    } else if (!is_name_char(p[1], 1)) {
+        len = 1;                    // $?, $$ and $0 - $9
+        last = p + 1;
+    } else {
+        len = 1;
+        while (is_name_char(name[len], 0)) len++;
+        last = name + len - 1;
+    }
+
+    if (quoted) b->started = 1;
+
+    char number[24];
+    const char* value = NULL;
+    if (len == 1 && *name == '?') {
+        snprintf(number, sizeof(number), "%d", last_status);
+        value = number;
+    } else if (len == 1 && *name == '$') {
+        snprintf(number, sizeof(number), "%d", (int)getpid());
+        value = number;
+    } else {
+        // Variable names are short; a long one is copied into the arena
+        char buf[NAME_BUFFER];
+        char* key = len < sizeof(buf) ? buf : (char*)arena_alloc(&cmd_arena, len + 1);
+        memcpy(key, name, len);
+        key[len] = '\0';
+        var_node_t* var = find_variable(key);
+        if (var != NULL) value = var->value;
+    }
+    if (value != NULL) put_bytes(b, value, strlen(value));
+    return last;
+}
+
+// ============ ONE PASS OVER A WORD ============
+
+static void build_word(word_builder_t* b, const char* word) {
+    char quote = '\0';
+
+    // Most words come out about as long as they went in: one allocation
+    b->capacity = strlen(word) + 32;
+    b->buf = (char*)arena_alloc(&cmd_arena, b->capacity);
+
+    for (const char* p = word; *p != '\0'; p++) {
+        if (quote == '\'') {
+            if (*p == '\'') quote = '\0';
+            else put_char(b, *p);
+        } else if (*p == '$' && p[1] == '(') {
+            const char* close = skip_substitution(p);
+            if (close == NULL) {
+                put_char(b, *p);
+                continue;
+            }
+            size_t len;
+            char* output = capture_command(p + 2, close - (p + 2), &len);
+            if (quote == '"') b->started = 1;
+            if (output != NULL) put_output(b, output, len, quote == '"');
+            free(output);
+            p = close;
+        } else if (*p == '$' && starts_parameter(p)) {
+            p = put_parameter(b, p, quote == '"');
+        } else if (*p == '\\' && p[1] != '\0'
+                   && (quote == '\0' || strchr("\"\\$`", p[1]) != NULL)) {
+            put_char(b, *++p);
+        } else if (quote == '"') {
+            if (*p == '"') quote = '\0';
+            else put_char(b, *p);
+        } else if (*p == '\'' || *p == '"') {
+            quote = *p;
+            b->started = 1;
+        } else {
+            put_char(b, *p);
+        }
+    }
+    end_word(b);
+}
+
+// Appends the words word expands to (none, for an unquoted word that
+// expanded to nothing) to the arena vector *list, regrowing it as needed
+void expand_word(const char* word, char*** list, int* count, int* capacity) {
+    word_builder_t b = { NULL, 0, 0, 0, 1, list, count, capacity, NULL };
+    build_word(&b, word);
+}
+
+// The value of VAR=value: quotes removed, parameters and substitutions
+// expanded, no splitting
+char* expand_assignment_value(const char* text) {
+    word_builder_t b = { NULL, 0, 0, 0, 0, NULL, NULL, NULL, NULL };
+    build_word(&b, text);
+    return b.single != NULL ? b.single : "";
+}
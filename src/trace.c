@@ -0,0 +1,226 @@
+/* trace.c
+ * Contains: Command-trace ring buffer and the "trace" built-in
+ * Hooks in the main loop, tokenize(), expand_variables(), spawn_stage()
+ * and the job table's wait / reap path append fixed-size binary records
+ * (monotonic time, event, begin/end, pid, hash of the input line) to a
+ * ring of TRACE_RING_RECORDS entries; once full the oldest are
+ * overwritten. With tracing off a hook is one test of trace_enabled.
+ *   trace on|off|clear    - start / stop recording, empty the ring
+ *   trace                 - show the state and the number of records
+ *   trace dump            - the ring as Chrome trace JSON (chrome://tracing,
+ *                           Perfetto): shell work on the shell's own row,
+ *                           each child from spawn to reap on a row of its own;
+ *                           what is still open (the dump's own command line,
+ *                           running children) ends at the time of the dump
+ * Called by: main.c, shell.c, spawn.c, jobs.c, builtins.c
+ */
+
+#include "shell.h"
+#include <stdint.h>
+#include <time.h>
+
+#define TRACE_RING_RECORDS 65536    // power of two
+#define TRACE_TEXT_SLOTS 4096       // distinct command lines kept for dump
+#define TRACE_TEXT_MAX 200
+#define TRACE_DUMP_DEPTH 32         // open shell slices named at dump time
+
+typedef struct {
+    uint64_t ns;
+    uint32_t cmd_hash;
+    int32_t pid;
+    uint8_t type;
+    uint8_t phase;
+} trace_record_t;
+
+typedef struct {
+    uint32_t hash;
+    char* text;
+} trace_text_t;
+
+static const char* const event_names[] = { "command", "tokenize", "expand", "spawn", "child", "wait" };
+
+int trace_enabled = 0;
+
+static trace_record_t* ring = NULL;
+static uint64_t ring_head = 0;      // records ever written
+static uint32_t current_hash = 0;
+
+static trace_text_t* texts = NULL;  // hash -> line, open addressing
+
+void trace_record(int type, int phase, pid_t pid) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    trace_record_t* r = &ring[ring_head++ & (TRACE_RING_RECORDS - 1)];
+    r->ns = (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+    r->cmd_hash = current_hash;
+    r->pid = pid;
+    r->type = type;
+    r->phase = phase;
+}
+
+// Main loop: a new input line starts. Its text is kept once per distinct
+// line so the dump can name the hash.
+void trace_command(const char* text) {
+    current_hash = fnv1a(text);
+    uint32_t mask = TRACE_TEXT_SLOTS - 1;
+    for (uint32_t i = current_hash & mask, n = 0; n < TRACE_TEXT_SLOTS; i = (i + 1) & mask, n++) {
+        if (texts[i].text == NULL) {
+            texts[i].hash = current_hash;
+            texts[i].text = strndup(text, TRACE_TEXT_MAX);
+            break;
+        }
+        if (texts[i].hash == current_hash) break;
+    }
+    trace_record(TRACE_COMMAND, TRACE_BEGIN, 0);
+}
+
+static const char* text_for(uint32_t hash) {
+    uint32_t mask = TRACE_TEXT_SLOTS - 1;
+    for (uint32_t i = hash & mask, n = 0; n < TRACE_TEXT_SLOTS; i = (i + 1) & mask, n++) {
+        if (texts[i].text == NULL) return NULL;
+        if (texts[i].hash == hash) return texts[i].text;
+    }
+    return NULL;
+}
+
+// ============ EXPORT ============
+
+static void print_json_string(const char* s) {
+    putchar('"');
+    for (; *s != '\0'; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') printf("\\%c", c);
+        else if (c < 0x20) printf("\\u%04x", c);
+        else putchar(c);
+    }
+    putchar('"');
+}
+
+static void print_event(const trace_record_t* r, const char* name, char phase, pid_t tid, pid_t shell) {
+    printf(",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+           name, phase, r->ns / 1000.0, shell, tid);
+    const char* text = text_for(r->cmd_hash);
+    if (phase == 'B') {
+        printf(",\"args\":{\"line\":");
+        if (text != NULL) print_json_string(text);
+        else printf("\"%08x\"", r->cmd_hash);
+        if (r->pid > 0) printf(",\"pid\":%d", r->pid);
+        putchar('}');
+    }
+    putchar('}');
+}
+
+// Spawn end doubles as the start of the child's row; its reap ends it.
+// Ends whose begin was overwritten are left out, and slices still open
+// get an end stamped now, so every B in the output has its E.
+static void trace_dump() {
+    pid_t shell = getpid();
+    uint64_t first = ring_head > TRACE_RING_RECORDS ? ring_head - TRACE_RING_RECORDS : 0;
+    int depth = 0;                  // open slices on the shell's row
+    uint8_t open_types[TRACE_DUMP_DEPTH];
+    pid_t* children = NULL;         // child rows begun and not yet ended
+    int nchildren = 0, children_capacity = 0;
+
+    printf("{\"otherData\":{\"records\":%llu,\"dropped\":%llu},\n\"traceEvents\":[\n",
+           (unsigned long long)(ring_head - first), (unsigned long long)first);
+    printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"myshell\"}}",
+           shell, shell);
+
+    for (uint64_t i = first; i < ring_head; i++) {
+        const trace_record_t* r = &ring[i & (TRACE_RING_RECORDS - 1)];
+        const char* name = event_names[r->type];
+        char phase = r->phase == TRACE_BEGIN ? 'B' : 'E';
+
+        if (r->type == TRACE_CHILD) {
+            for (int k = 0; k < nchildren; k++) {
+                if (children[k] != r->pid) continue;
+                children[k] = children[--nchildren];
+                print_event(r, name, 'E', r->pid, shell);
+                break;
+            }
+            continue;
+        }
+        if (phase == 'E' && depth == 0) continue;
+        if (phase == 'B' && depth < TRACE_DUMP_DEPTH) open_types[depth] = r->type;
+        depth += phase == 'B' ? 1 : -1;
+        print_event(r, name, phase, shell, shell);
+        if (r->type == TRACE_SPAWN && r->phase == TRACE_END && r->pid > 0) {
+            if (nchildren == children_capacity) {
+                children_capacity = children_capacity ? children_capacity * 2 : 16;
+                pid_t* bigger = (pid_t*)realloc(children, sizeof(pid_t) * children_capacity);
+                if (bigger == NULL) { perror("trace: out of memory"); break; }
+                children = bigger;
+            }
+            children[nchildren++] = r->pid;
+            printf(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                   "\"args\":{\"name\":\"child %d\"}}", shell, r->pid, r->pid);
+            print_event(r, event_names[TRACE_CHILD], 'B', r->pid, shell);
+        }
+    }
+
+    // Close what is still open at the time of the dump
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    trace_record_t now;
+    memset(&now, 0, sizeof(now));
+    now.ns = (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+    for (; depth > 0; depth--) {
+        int type = depth <= TRACE_DUMP_DEPTH ? open_types[depth - 1] : TRACE_COMMAND;
+        print_event(&now, event_names[type], 'E', shell, shell);
+    }
+    for (int k = 0; k < nchildren; k++) print_event(&now, event_names[TRACE_CHILD], 'E', children[k], shell);
+    free(children);
+    printf("\n]}\n");
+}
+
+static void trace_clear() {
+    ring_head = 0;
+    if (texts == NULL) return;
+    for (int i = 0; i < TRACE_TEXT_SLOTS; i++) free(texts[i].text);
+    memset(texts, 0, sizeof(trace_text_t) * TRACE_TEXT_SLOTS);
+}
+
+// The ring is only allocated once tracing is first turned on
+static int trace_start() {
+    if (ring == NULL) {
+        ring = (trace_record_t*)malloc(sizeof(trace_record_t) * TRACE_RING_RECORDS);
+        texts = (trace_text_t*)calloc(TRACE_TEXT_SLOTS, sizeof(trace_text_t));
+        if (ring == NULL || texts == NULL) {
+            perror("trace: out of memory");
+            trace_free();
+            return 1;
+        }
+    }
+    trace_enabled = 1;
+    return 0;
+}
+
+int builtin_trace(char** argv) {
+    if (argv[1] == NULL) {
+        uint64_t kept = ring_head > TRACE_RING_RECORDS ? TRACE_RING_RECORDS : ring_head;
+        printf("trace: %s, %llu records (%llu overwritten)\n", trace_enabled ? "on" : "off",
+               (unsigned long long)kept, (unsigned long long)(ring_head - kept));
+    } else if (strcmp(argv[1], "on") == 0) {
+        return trace_start();
+    } else if (strcmp(argv[1], "off") == 0) {
+        trace_enabled = 0;
+    } else if (strcmp(argv[1], "clear") == 0) {
+        trace_clear();
+    } else if (strcmp(argv[1], "dump") == 0) {
+        trace_dump();
+    } else {
+        fprintf(stderr, "Usage: trace [on|off|clear|dump]\n");
+        return 2;
+    }
+    return 0;
+}
+
+void trace_free() {
+    trace_clear();
+    trace_enabled = 0;
+    free(ring);
+    free(texts);
+    ring = NULL;
+    texts = NULL;
+}
@@ -0,0 +1,178 @@
+/* usage.c
+ * Contains: Per-command resource accounting, the "time" prefix and the
+ *           "stats" built-in
+ * Every foreground child is collected with wait4() (jobs.c), and its rusage
+ * is added to the running command's total; work done inside the shell itself
+ * (built-ins, in-process cat/tee) is the getrusage(RUSAGE_SELF) delta.
+ *   time cmd [| cmd ...]     - report wall, user, sys, max RSS and context
+ *                              switches on stderr once the command finishes
+ *   stats on|off|clear       - record those numbers for every command
+ *   stats [dump]             - print the recorded table
+ * Called by: execute.c run_command(), wait_pipeline(); jobs.c, subst.c
+ */
+
+#include "shell.h"
+
+#define STATS_INITIAL 256
+
+typedef struct {
+    char* text;
+    int status;
+    cmd_usage_t usage;
+} stats_record_t;
+
+// Child usage collected since the current command started
+static struct rusage children;
+
+static int stats_enabled = 0;
+static stats_record_t* records = NULL;
+static long nrecords = 0;
+static long records_capacity = 0;
+
+static double tv_seconds(struct timeval tv) {
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double ts_seconds(struct timespec ts) {
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Sums times and context switches; max RSS stays the largest single one
+void rusage_add(struct rusage* total, const struct rusage* ru) {
+    timeradd(&total->ru_utime, &ru->ru_utime, &total->ru_utime);
+    timeradd(&total->ru_stime, &ru->ru_stime, &total->ru_stime);
+    if (ru->ru_maxrss > total->ru_maxrss) total->ru_maxrss = ru->ru_maxrss;
+    total->ru_nvcsw += ru->ru_nvcsw;
+    total->ru_nivcsw += ru->ru_nivcsw;
+}
+
+// Called with the usage of each waited-for foreground child or job
+void usage_add_child(const struct rusage* ru) {
+    rusage_add(&children, ru);
+}
+
+void usage_begin(usage_probe_t* probe) {
+    memset(&children, 0, sizeof(children));
+    getrusage(RUSAGE_SELF, &probe->self);
+    clock_gettime(CLOCK_MONOTONIC, &probe->start);
+}
+
+// Folds the children collected since usage_begin() and the shell's own
+// delta into out. Max RSS is the largest single process, not a sum.
+void usage_end(const usage_probe_t* probe, cmd_usage_t* out) {
+    struct timespec now;
+    struct rusage self;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    getrusage(RUSAGE_SELF, &self);
+
+    out->wall = ts_seconds(now) - ts_seconds(probe->start);
+    out->user = tv_seconds(children.ru_utime)
+              + tv_seconds(self.ru_utime) - tv_seconds(probe->self.ru_utime);
+    out->sys = tv_seconds(children.ru_stime)
+             + tv_seconds(self.ru_stime) - tv_seconds(probe->self.ru_stime);
+    out->maxrss_kb = children.ru_maxrss;
+    out->nvcsw = children.ru_nvcsw + self.ru_nvcsw - probe->self.ru_nvcsw;
+    out->nivcsw = children.ru_nivcsw + self.ru_nivcsw - probe->self.ru_nivcsw;
+
+    // A command that never left the shell: report the shell's own peak
+    if (out->maxrss_kb == 0) out->maxrss_kb = self.ru_maxrss;
+}
+
+void usage_report(const cmd_usage_t* u) {
+    fprintf(stderr, "real %.3fs  user %.3fs  sys %.3fs  maxrss %ldK  csw %ld/%ld\n",
+            u->wall, u->user, u->sys, u->maxrss_kb, u->nvcsw, u->nivcsw);
+}
+
+// ============ PER-COMMAND RECORDING ============
+
+int stats_recording() {
+    return stats_enabled;
+}
+
+// Joins the words of a command (operators included) into a malloc'd line
+static char* join_words(char** argv) {
+    size_t len = 1;
+    for (int i = 0; argv[i] != NULL; i++) len += strlen(argv[i]) + 1;
+
+    char* text = (char*)malloc(len);
+    if (text == NULL) return NULL;
+    char* p = text;
+    for (int i = 0; argv[i] != NULL; i++) {
+        if (i > 0) *p++ = ' ';
+        size_t n = strlen(argv[i]);
+        memcpy(p, argv[i], n);
+        p += n;
+    }
+    *p = '\0';
+    return text;
+}
+
+// argv must be captured before the command runs: parsing compacts it.
+// "stats" itself is never recorded.
+char* stats_command_text(char** argv) {
+    if (!stats_enabled || strcmp(argv[0], "stats") == 0) return NULL;
+    return join_words(argv);
+}
+
+// Takes ownership of text
+void stats_record(char* text, int status, const cmd_usage_t* usage) {
+    if (text == NULL) return;
+    if (nrecords == records_capacity) {
+        long new_capacity = records_capacity ? records_capacity * 2 : STATS_INITIAL;
+        stats_record_t* bigger = (stats_record_t*)realloc(records, sizeof(stats_record_t) * new_capacity);
+        if (bigger == NULL) {
+            free(text);
+            return;
+        }
+        records = bigger;
+        records_capacity = new_capacity;
+    }
+    records[nrecords].text = text;
+    records[nrecords].status = status;
+    records[nrecords].usage = *usage;
+    nrecords++;
+}
+
+static void stats_clear() {
+    for (long i = 0; i < nrecords; i++) free(records[i].text);
+    nrecords = 0;
+}
+
+static void stats_dump() {
+    cmd_usage_t total = { 0 };
+    printf("# wall\tuser\tsys\tmaxrss_kb\tvcsw\tivcsw\tstatus\tcommand\n");
+    for (long i = 0; i < nrecords; i++) {
+        const cmd_usage_t* u = &records[i].usage;
+        printf("%.6f\t%.6f\t%.6f\t%ld\t%ld\t%ld\t%d\t%s\n",
+               u->wall, u->user, u->sys, u->maxrss_kb, u->nvcsw, u->nivcsw,
+               records[i].status, records[i].text);
+        total.wall += u->wall;
+        total.user += u->user;
+        total.sys += u->sys;
+    }
+    printf("# %ld commands, wall %.3fs, user %.3fs, sys %.3fs\n",
+           nrecords, total.wall, total.user, total.sys);
+}
+
+int builtin_stats(char** argv) {
+    if (argv[1] == NULL || strcmp(argv[1], "dump") == 0) {
+        stats_dump();
+    } else if (strcmp(argv[1], "on") == 0) {
+        stats_enabled = 1;
+    } else if (strcmp(argv[1], "off") == 0) {
+        stats_enabled = 0;
+    } else if (strcmp(argv[1], "clear") == 0) {
+        stats_clear();
+    } else {
+        fprintf(stderr, "Usage: stats [on|off|dump|clear]\n");
+        return 2;
+    }
+    return 0;
+}
+
+void stats_free() {
+    stats_clear();
+    free(records);
+    records = NULL;
+    records_capacity = 0;
+}
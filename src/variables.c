@@ -0,0 +1,249 @@
+/* variables.c
+ * Contains: Feature 8 variable store
+ * Open-addressing hash table (linear probing, FNV-1a) behind the
+ * find_variable / set_variable / print_all_variables / free_all_variables
+ * API, so lookups stay O(1) no matter how many variables a script keeps.
+ * Each slot caches its name's hash, so a probe only falls back to strcmp
+ * when the full hash already matches.
+ * Exported variables also keep a "name=value" entry. shell_envp() hands
+ * the spawn backends one envp array of those entries, rebuilt only after
+ * an exported variable changed, so the number of exports never costs
+ * anything per exec. For prefix assignments (VAR=value cmd) main.c lays a
+ * one-command overlay over it. Only libc is needed here, so bench_vars
+ * links this file on its own.
+ * Called by: shell.c (expand_variables), builtins.c (set, export),
+ *            main.c (assignments, environment import), spawn.c, zygote.c,
+ *            pathhash.c and trace.c (fnv1a)
+ */
+
+#include "shell.h"
+
+#define VAR_TABLE_MIN 64
+
+static var_node_t* var_slots = NULL;
+static size_t var_capacity = 0;     // always a power of two
+static size_t var_count = 0;
+
+static char** envp_cache = NULL;    // entries of the exported variables
+static size_t envp_capacity = 0;
+static size_t exported_count = 0;
+static int envp_dirty = 1;
+static char** envp_overlay = NULL;  // set while a prefixed command starts
+
+// FNV-1a: the string hash behind every table in the shell (variables,
+// the PATH cache, the trace text table)
+unsigned int fnv1a(const char* text) {
+    unsigned int h = 2166136261u;
+    while (*text) {
+        h ^= (unsigned char)*text++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Returns the slot holding name, or the empty slot where it would go
+static var_node_t* probe(const char* name, unsigned int hash) {
+    size_t mask = var_capacity - 1;
+    size_t i = hash & mask;
+
+    while (var_slots[i].name != NULL) {
+        if (var_slots[i].hash == hash && strcmp(var_slots[i].name, name) == 0) {
+            return &var_slots[i];
+        }
+        i = (i + 1) & mask;
+    }
+    return &var_slots[i];
+}
+
+// Doubles the table (or creates it) and re-inserts every variable
+static int grow_table() {
+    size_t new_capacity = var_capacity ? var_capacity * 2 : VAR_TABLE_MIN;
+    var_node_t* new_slots = (var_node_t*)calloc(new_capacity, sizeof(var_node_t));
+    if (new_slots == NULL) return -1;
+
+    var_node_t* old_slots = var_slots;
+    size_t old_capacity = var_capacity;
+    var_slots = new_slots;
+    var_capacity = new_capacity;
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_slots[i].name != NULL) {
+            *probe(old_slots[i].name, old_slots[i].hash) = old_slots[i];
+        }
+    }
+    free(old_slots);
+    return 0;
+}
+
+// Find variable by name. The returned node stays valid until the next
+// set_variable() call, which may move it when the table grows.
+var_node_t* find_variable(const char* name) {
+    if (var_count == 0 || name == NULL) return NULL;
+
+    var_node_t* slot = probe(name, fnv1a(name));
+    return slot->name != NULL ? slot : NULL;
+}
+
+// Rebuilds an exported variable's "name=value" after its value changed
+static void refresh_entry(var_node_t* slot) {
+    size_t name_len = strlen(slot->name);
+    size_t value_len = strlen(slot->value);
+    char* entry = (char*)malloc(name_len + value_len + 2);
+    if (entry == NULL) return;
+    memcpy(entry, slot->name, name_len);
+    entry[name_len] = '=';
+    memcpy(entry + name_len + 1, slot->value, value_len + 1);
+
+    free(slot->entry);
+    slot->entry = entry;
+    envp_dirty = 1;
+}
+
+// Set or create variable
+void set_variable(const char* name, const char* value) {
+    if (name == NULL || value == NULL) return;
+
+    // Keep the load factor at or below 1/2 so probe chains stay short
+    if ((var_count + 1) * 2 > var_capacity && grow_table() != 0) return;
+
+    unsigned int hash = fnv1a(name);
+    var_node_t* slot = probe(name, hash);
+
+    if (slot->name != NULL) {
+        char* copy = strdup(value);
+        if (copy == NULL) return;
+        free(slot->value);
+        slot->value = copy;
+        if (slot->entry != NULL) refresh_entry(slot);
+        return;
+    }
+
+    slot->name = strdup(name);
+    slot->value = strdup(value);
+    slot->hash = hash;
+    var_count++;
+}
+
+static int compare_var_names(const void* a, const void* b) {
+    const var_node_t* va = *(const var_node_t* const*)a;
+    const var_node_t* vb = *(const var_node_t* const*)b;
+    return strcmp(va->name, vb->name);
+}
+
+// Print all variables, sorted by name
+void print_all_variables() {
+    if (var_count == 0) {
+        printf("No variables set\n");
+        return;
+    }
+
+    var_node_t** sorted = (var_node_t**)malloc(sizeof(var_node_t*) * var_count);
+    if (sorted == NULL) return;
+
+    size_t n = 0;
+    for (size_t i = 0; i < var_capacity; i++) {
+        if (var_slots[i].name != NULL) sorted[n++] = &var_slots[i];
+    }
+    qsort(sorted, n, sizeof(var_node_t*), compare_var_names);
+
+    printf("Shell Variables:\n");
+    for (size_t i = 0; i < n; i++) {
+        printf("%s=%s\n", sorted[i]->name, sorted[i]->value);
+    }
+    free(sorted);
+}
+
+// Free all variables
+void free_all_variables() {
+    for (size_t i = 0; i < var_capacity; i++) {
+        if (var_slots[i].name != NULL) {
+            free(var_slots[i].name);
+            free(var_slots[i].value);
+            free(var_slots[i].entry);
+        }
+    }
+    free(var_slots);
+    var_slots = NULL;
+    var_capacity = 0;
+    var_count = 0;
+
+    free(envp_cache);
+    envp_cache = NULL;
+    envp_capacity = 0;
+    exported_count = 0;
+    envp_dirty = 1;
+}
+
+// ============ EXPORTED VARIABLES ============
+
+// export name[=value]: a name without a value keeps its current one
+// (an unset name is exported empty)
+void export_variable(const char* name, const char* value) {
+    if (value != NULL || find_variable(name) == NULL) set_variable(name, value ? value : "");
+
+    var_node_t* slot = find_variable(name);
+    if (slot == NULL || slot->entry != NULL) return;
+    refresh_entry(slot);
+    if (slot->entry != NULL) exported_count++;
+}
+
+// export -n name: stays a shell variable, leaves the environment
+void unexport_variable(const char* name) {
+    var_node_t* slot = find_variable(name);
+    if (slot == NULL || slot->entry == NULL) return;
+    free(slot->entry);
+    slot->entry = NULL;
+    exported_count--;
+    envp_dirty = 1;
+}
+
+// Print the exported variables, sorted by name
+void print_exported_variables() {
+    var_node_t** sorted = (var_node_t**)malloc(sizeof(var_node_t*) * (exported_count + 1));
+    if (sorted == NULL) return;
+
+    size_t n = 0;
+    for (size_t i = 0; i < var_capacity; i++) {
+        if (var_slots[i].entry != NULL) sorted[n++] = &var_slots[i];
+    }
+    qsort(sorted, n, sizeof(var_node_t*), compare_var_names);
+
+    for (size_t i = 0; i < n; i++) {
+        printf("export %s\n", sorted[i]->entry);
+    }
+    free(sorted);
+}
+
+// The envp for the next exec. Rebuilt here only if an exported variable
+// changed since the last call; valid until the next set_variable().
+char** shell_envp() {
+    if (envp_overlay != NULL) return envp_overlay;
+    if (!envp_dirty) return envp_cache;
+
+    if (exported_count + 1 > envp_capacity) {
+        size_t capacity = envp_capacity ? envp_capacity : 64;
+        while (capacity < exported_count + 1) capacity *= 2;
+        char** bigger = (char**)realloc(envp_cache, sizeof(char*) * capacity);
+        if (bigger == NULL) return envp_cache;
+        envp_cache = bigger;
+        envp_capacity = capacity;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < var_capacity; i++) {
+        if (var_slots[i].entry != NULL) envp_cache[n++] = var_slots[i].entry;
+    }
+    envp_cache[n] = NULL;
+    envp_dirty = 0;
+    return envp_cache;
+}
+
+// VAR=value cmd: until clear_env_overlay(), shell_envp() returns envp,
+// which main.c builds from shell_envp() and the prefix assignments
+void set_env_overlay(char** envp) {
+    envp_overlay = envp;
+}
+
+void clear_env_overlay() {
+    envp_overlay = NULL;
+}
@@ -0,0 +1,446 @@
+/* zygote.c
+ * Contains: The "zygote" spawn backend, a small helper process that does
+ * fork/exec on the shell's behalf
+ * The helper is this binary re-executed as "myshell --zygote FD", so it
+ * starts from a fresh, tiny address space and stays that way: its fork()
+ * copies a few page tables no matter how large the shell has grown.
+ * Protocol, one SOCK_SEQPACKET socketpair, one message per datagram:
+ *   shell -> helper  request: argc/envc, the CPU set to pin the child to
+ *                    (if any), then path, argv and envp as
+ *                    NUL-terminated strings; SCM_RIGHTS carries the working
+ *                    directory and the fds for stdin, stdout and stderr
+ *   helper -> shell  STARTED (pid, or the exec errno) for each request,
+ *                    EXITED (wait status and rusage) whenever a child ends
+ * Exit reports arrive asynchronously: the socket sits in the jobs.c epoll
+ * set next to the pidfds. A report for a pid that jobs_add() has not
+ * registered yet is kept here until it is.
+ * Called by: spawn.c (zygote backend), jobs.c (event loop), main.c
+ */
+
+#include "shell.h"
+#include <poll.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+
+#define ZYGOTE_MAX_MESSAGE (64 * 1024)  // larger commands use posix_spawn
+#define ZYGOTE_NFDS 4                   // cwd, stdin, stdout, stderr
+
+enum { ZYGOTE_STARTED = 1, ZYGOTE_EXITED = 2 };
+
+typedef struct {
+    uint32_t argc;
+    uint32_t envc;
+    uint32_t pinned;        // cpus holds the child's affinity mask
+    cpu_set_t cpus;
+} zygote_request_t;
+
+typedef struct {
+    int32_t type;
+    int32_t pid;
+    int32_t error;          // STARTED: errno of a failed exec, else 0
+    int32_t status;         // EXITED: wait status
+    struct rusage usage;
+} zygote_reply_t;
+
+typedef struct {
+    pid_t pid;
+    int status;
+    struct rusage usage;
+} early_exit_t;
+
+static char message[ZYGOTE_MAX_MESSAGE];
+
+static int zygote_sock = -1;
+static pid_t zygote_pid = -1;
+
+// EXITED reports that arrived before their job was registered
+static early_exit_t* early = NULL;
+static int nearly = 0;
+static int early_capacity = 0;
+
+typedef union {
+    char buf[CMSG_SPACE(sizeof(int) * ZYGOTE_NFDS)];
+    struct cmsghdr align;
+} fd_control_t;
+
+// ============ SHELL SIDE ============
+
+int zygote_running() {
+    return zygote_sock >= 0;
+}
+
+// Starts the helper (once); it needs the event loop for exit reports
+int zygote_start() {
+    if (zygote_sock >= 0) return 0;
+    if (jobs_event_fd() < 0) {
+        fprintf(stderr, "spawn: zygote needs the child event loop\n");
+        return -1;
+    }
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+        perror("socketpair failed");
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork failed");
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        // Only the helper's end of the socket survives the exec
+        char fd_arg[16];
+        int fd = fcntl(sv[1], F_DUPFD, 3);
+        snprintf(fd_arg, sizeof(fd_arg), "%d", fd);
+        execl("/proc/self/exe", "myshell", "--zygote", fd_arg, (char*)NULL);
+        perror("zygote: exec failed");
+        _exit(127);
+    }
+
+    close(sv[1]);
+    zygote_sock = sv[0];
+    zygote_pid = pid;
+    jobs_watch_zygote(zygote_sock);
+    return 0;
+}
+
+// Hands an exit report to the job table, or keeps it until the pid is
+// registered. Returns 1 if it finished a job.
+static int note_exit(const zygote_reply_t* reply) {
+    int finished = jobs_remote_exit(reply->pid, reply->status, &reply->usage);
+    if (finished >= 0) return finished;
+
+    if (nearly == early_capacity) {
+        int new_capacity = early_capacity ? early_capacity * 2 : 16;
+        early_exit_t* bigger = (early_exit_t*)realloc(early, sizeof(early_exit_t) * new_capacity);
+        if (bigger == NULL) return 0;
+        early = bigger;
+        early_capacity = new_capacity;
+    }
+    early[nearly].pid = reply->pid;
+    early[nearly].status = reply->status;
+    early[nearly].usage = reply->usage;
+    nearly++;
+    return 0;
+}
+
+// jobs_add(): has pid already exited? Removes and returns its report.
+int zygote_take_exit(pid_t pid, int* status, struct rusage* usage) {
+    for (int i = 0; i < nearly; i++) {
+        if (early[i].pid != pid) continue;
+        *status = early[i].status;
+        *usage = early[i].usage;
+        early[i] = early[--nearly];
+        return 1;
+    }
+    return 0;
+}
+
+// The helper went away: its children can no longer be waited for, so
+// their jobs are finished with status 255 and posix_spawn takes over
+static void zygote_lost() {
+    fprintf(stderr, "myshell: zygote exited, falling back to posix_spawn\n");
+    close(zygote_sock);         // also leaves the epoll set
+    zygote_sock = -1;
+    waitpid(zygote_pid, NULL, 0);
+    zygote_pid = -1;
+    nearly = 0;
+    if (spawn_mode == SPAWN_ZYGOTE) spawn_mode = SPAWN_POSIX;
+    jobs_fail_remote(255 << 8);
+}
+
+// Event loop callback: handles every report waiting on the socket.
+// Returns the number of jobs that finished.
+int zygote_dispatch() {
+    int finished = 0;
+    zygote_reply_t reply;
+    while (zygote_sock >= 0) {
+        ssize_t n = recv(zygote_sock, &reply, sizeof(reply), MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n != (ssize_t)sizeof(reply)) {
+            zygote_lost();
+            break;
+        }
+        if (reply.type == ZYGOTE_EXITED) finished += note_exit(&reply);
+    }
+    return finished;
+}
+
+static char* put_string(char* p, const char* s) {
+    size_t len = strlen(s) + 1;
+    if (p == NULL || (size_t)(message + sizeof(message) - p) < len) return NULL;
+    memcpy(p, s, len);
+    return p + len;
+}
+
+// Starts path with argv in the helper, stdin/stdout on in_fd/out_fd (-1 =
+// the shell's own), pinned to cpus unless NULL. Returns the pid; -1 with
+// *err set if exec failed; or ZYGOTE_UNAVAILABLE, having done nothing,
+// when the caller should spawn directly (no helper, or a command too
+// large for one message).
+pid_t zygote_spawn(const char* path, char** argv, int in_fd, int out_fd, const cpu_set_t* cpus, int* err) {
+    if (zygote_sock < 0) return ZYGOTE_UNAVAILABLE;
+
+    zygote_request_t header;
+    memset(&header, 0, sizeof(header));
+    if (cpus != NULL) {
+        header.pinned = 1;
+        header.cpus = *cpus;
+    }
+    char* p = message + sizeof(header);
+    p = put_string(p, path);
+    for (; argv[header.argc] != NULL; header.argc++) p = put_string(p, argv[header.argc]);
+    char** envp = shell_envp();
+    for (; envp[header.envc] != NULL; header.envc++) p = put_string(p, envp[header.envc]);
+    if (p == NULL) return ZYGOTE_UNAVAILABLE;
+    memcpy(message, &header, sizeof(header));
+
+    int cwd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (cwd < 0) return ZYGOTE_UNAVAILABLE;
+    int fds[ZYGOTE_NFDS] = { cwd, in_fd != -1 ? in_fd : STDIN_FILENO,
+                             out_fd != -1 ? out_fd : STDOUT_FILENO, STDERR_FILENO };
+
+    fd_control_t control;
+    struct iovec iov = { message, (size_t)(p - message) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    ssize_t sent;
+    while ((sent = sendmsg(zygote_sock, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR) {}
+    close(cwd);
+    if (sent < 0) {
+        zygote_lost();
+        return ZYGOTE_UNAVAILABLE;
+    }
+
+    // Requests are served in order; exit reports may come first
+    zygote_reply_t reply;
+    while (1) {
+        ssize_t n = recv(zygote_sock, &reply, sizeof(reply), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n != (ssize_t)sizeof(reply)) {
+            zygote_lost();
+            *err = EIO;
+            return -1;
+        }
+        if (reply.type == ZYGOTE_STARTED) break;
+        note_exit(&reply);
+    }
+
+    if (reply.pid <= 0) {
+        *err = reply.error;
+        return -1;
+    }
+    return reply.pid;
+}
+
+// A forked copy of the shell must not share the parent's socket
+void zygote_forget() {
+    if (zygote_sock >= 0) close(zygote_sock);
+    zygote_sock = -1;
+    zygote_pid = -1;
+    nearly = 0;
+}
+
+// Closing the socket tells the helper to exit; running children are left be
+void zygote_stop() {
+    zygote_forget();
+    free(early);
+    early = NULL;
+    early_capacity = 0;
+}
+
+// ============ HELPER SIDE ============
+
+static void send_reply(int sock, zygote_reply_t* reply) {
+    while (send(sock, reply, sizeof(*reply), MSG_NOSIGNAL) < 0 && errno == EINTR) {}
+}
+
+// Reports every child that has exited
+static void report_exits(int sock) {
+    zygote_reply_t reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.type = ZYGOTE_EXITED;
+    pid_t pid;
+    while ((pid = wait4(-1, &reply.status, WNOHANG, &reply.usage)) > 0) {
+        reply.pid = pid;
+        send_reply(sock, &reply);
+    }
+}
+
+// Splits count NUL-terminated strings off *p (bounded by end) into a
+// malloc'd NULL-terminated vector; NULL if the message is malformed
+static char** unpack_strings(char** p, const char* end, uint32_t count) {
+    char** vec = (char**)malloc(sizeof(char*) * (count + 1));
+    if (vec == NULL) return NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        char* nul = memchr(*p, '\0', end - *p);
+        if (nul == NULL) {
+            free(vec);
+            return NULL;
+        }
+        vec[i] = *p;
+        *p = nul + 1;
+    }
+    vec[count] = NULL;
+    return vec;
+}
+
+// fork + exec for one request. Exec failures come back through a
+// close-on-exec pipe, so STARTED carries either a running pid or an errno.
+static pid_t start_child(char* path, char** argv, char** envp, const cpu_set_t* cpus, const int* fds, int* err) {
+    int errpipe[2];
+    if (pipe2(errpipe, O_CLOEXEC) < 0) {
+        *err = errno;
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        *err = errno;
+        close(errpipe[0]);
+        close(errpipe[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, NULL);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGQUIT, SIG_DFL);
+
+        int e = 0;
+        if (fchdir(fds[0]) < 0) e = errno;
+        for (int i = 1; i < ZYGOTE_NFDS && e == 0; i++) {
+            if (dup2(fds[i], i - 1) < 0) e = errno;
+        }
+        if (e == 0) {
+            placement_apply(0, cpus);
+            execve(path, argv, envp);
+            e = errno;
+        }
+        if (write(errpipe[1], &e, sizeof(e)) < 0) {
+            // the helper sees EOF and assumes success; nothing else to do
+        }
+        _exit(127);
+    }
+
+    close(errpipe[1]);
+    ssize_t n;
+    while ((n = read(errpipe[0], err, sizeof(*err))) < 0 && errno == EINTR) {}
+    close(errpipe[0]);
+    if (n == (ssize_t)sizeof(*err)) {
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    *err = 0;
+    return pid;
+}
+
+// Receives and serves one request; -1 when the shell has gone away
+static int serve_request(int sock) {
+    fd_control_t control;
+    struct iovec iov = { message, sizeof(message) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    if (n < 0) return errno == EINTR ? 0 : -1;
+    if (n == 0) return -1;
+
+    int fds[ZYGOTE_NFDS];
+    int nfds = 0;
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        nfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        if (nfds > ZYGOTE_NFDS) nfds = ZYGOTE_NFDS;
+        memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * nfds);
+    }
+
+    zygote_reply_t reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.type = ZYGOTE_STARTED;
+    reply.pid = -1;
+    reply.error = EINVAL;
+
+    zygote_request_t header;
+    if (nfds == ZYGOTE_NFDS && (size_t)n > sizeof(header)) {
+        memcpy(&header, message, sizeof(header));
+        char* p = message + sizeof(header);
+        const char* end = message + n;
+        char** path = unpack_strings(&p, end, 1);
+        char** argv = path ? unpack_strings(&p, end, header.argc) : NULL;
+        char** envp = argv ? unpack_strings(&p, end, header.envc) : NULL;
+        if (envp != NULL) reply.pid = start_child(path[0], argv, envp, header.pinned ? &header.cpus : NULL, fds, &reply.error);
+        free(path);
+        free(argv);
+        free(envp);
+    }
+    for (int i = 0; i < nfds; i++) close(fds[i]);
+
+    send_reply(sock, &reply);
+    return 0;
+}
+
+// Entry point of "myshell --zygote FD": serves requests until the shell
+// closes its end, reporting exits as SIGCHLD arrives on a signalfd
+int zygote_main(int sock) {
+    sigset_t chld;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, NULL);
+    int sfd = signalfd(-1, &chld, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (sfd < 0) {
+        perror("zygote: signalfd failed");
+        return 1;
+    }
+
+    // ^C and ^\ from the terminal are meant for the commands, not for us;
+    // stdin and stdout are not ours to hold open
+    signal(SIGINT, SIG_IGN);
+    signal(SIGQUIT, SIG_IGN);
+    int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        if (null_fd > STDERR_FILENO) close(null_fd);
+    }
+    fcntl(sock, F_SETFD, FD_CLOEXEC);
+    prctl(PR_SET_NAME, "myshell-zygote");
+
+    struct pollfd pfd[2] = { { sock, POLLIN, 0 }, { sfd, POLLIN, 0 } };
+    while (1) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfd[1].revents) {
+            struct signalfd_siginfo info;
+            while (read(sfd, &info, sizeof(info)) > 0) {
+                // just draining; wait4() finds every exited child
+            }
+            report_exits(sock);
+        }
+        if (pfd[0].revents && serve_request(sock) < 0) break;
+    }
+    return 0;
+}